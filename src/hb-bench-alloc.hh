@@ -0,0 +1,121 @@
+/*
+ * Copyright © 2026  Google, Inc.
+ *
+ *  This is part of HarfBuzz, a text shaping library.
+ *
+ * Permission is hereby granted, without written agreement and without
+ * license or royalty fees, to use, copy, modify, and distribute this
+ * software and its documentation for any purpose, provided that the
+ * above copyright notice and the following two paragraphs appear in
+ * all copies of this software.
+ *
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES
+ * ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN
+ * IF THE COPYRIGHT HOLDER HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * THE COPYRIGHT HOLDER SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING,
+ * BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE COPYRIGHT HOLDER HAS NO OBLIGATION TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ */
+
+#ifndef HB_BENCH_ALLOC_HH
+#define HB_BENCH_ALLOC_HH
+
+#include "hb.hh"
+
+
+/*
+ * Counting allocator, for the benchmarks.
+ *
+ * A program including this header links a copy of the library of its own,
+ * built with hb_malloc_impl and friends pointing to hb_bench_malloc() and
+ * friends.  Only one of its translation units may include it.
+ */
+
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+
+struct alloc_counters_t
+{
+  uint64_t allocs;
+  uint64_t bytes;
+  uint64_t live;
+  uint64_t peak;
+};
+
+static alloc_counters_t counters;
+
+/* Each block is prefixed with its size, in a header that keeps the
+ * alignment malloc() guarantees. */
+union alloc_header_t
+{
+  size_t size;
+  long double align_ld;
+  void *align_p;
+};
+
+static inline void *
+account_alloc (alloc_header_t *header, size_t size)
+{
+  if (unlikely (!header))
+    return nullptr;
+  header->size = size;
+  counters.allocs++;
+  counters.bytes += size;
+  counters.live += size;
+  counters.peak = MAX (counters.peak, counters.live);
+  return header + 1;
+}
+
+extern "C" void *
+hb_bench_malloc (size_t size)
+{
+  if (unlikely (size > (size_t) -1 - sizeof (alloc_header_t)))
+    return nullptr;
+  return account_alloc ((alloc_header_t *) malloc (sizeof (alloc_header_t) + size), size);
+}
+
+extern "C" void *
+hb_bench_calloc (size_t nmemb, size_t size)
+{
+  if (unlikely (size && nmemb > ((size_t) -1 - sizeof (alloc_header_t)) / size))
+    return nullptr;
+  return account_alloc ((alloc_header_t *) calloc (1, sizeof (alloc_header_t) + nmemb * size),
+			nmemb * size);
+}
+
+extern "C" void
+hb_bench_free (void *ptr)
+{
+  if (!ptr)
+    return;
+  alloc_header_t *header = (alloc_header_t *) ptr - 1;
+  counters.live -= header->size;
+  free (header);
+}
+
+extern "C" void *
+hb_bench_realloc (void *ptr, size_t size)
+{
+  if (!ptr)
+    return hb_bench_malloc (size);
+  if (unlikely (size > (size_t) -1 - sizeof (alloc_header_t)))
+    return nullptr;
+
+  alloc_header_t *header = (alloc_header_t *) ptr - 1;
+  size_t old_size = header->size;
+  header = (alloc_header_t *) realloc (header, sizeof (alloc_header_t) + size);
+  if (unlikely (!header))
+    return nullptr;
+  counters.live -= old_size;
+  return account_alloc (header, size);
+}
+
+
+#endif /* HB_BENCH_ALLOC_HH */
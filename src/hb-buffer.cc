@@ -29,6 +29,8 @@
 
 #include "hb-buffer.hh"
 #include "hb-utf.hh"
+#include "hb-machinery.hh"
+#include "hb-time.hh"
 
 
 /**
@@ -253,9 +255,28 @@ hb_buffer_t::clear (void)
   memset (context, 0, sizeof context);
   memset (context_len, 0, sizeof context_len);
 
+  lookup_counters[0].resize (0);
+  lookup_counters[1].resize (0);
+  decompositions = 0;
+
   deallocate_var_all ();
 }
 
+void
+hb_buffer_t::prepare_lookup_counters (unsigned int table_index, unsigned int lookup_count)
+{
+  hb_vector_t<hb_buffer_lookup_counters_t> &counters = lookup_counters[table_index];
+  if (unlikely (!counters.alloc (lookup_count)))
+    return;
+  while (counters.len < lookup_count)
+  {
+    hb_buffer_lookup_counters_t *entry = counters.push ();
+    memset (entry, 0, sizeof (*entry));
+    entry->table_tag = table_index ? HB_TAG ('G','P','O','S') : HB_TAG ('G','S','U','B');
+    entry->lookup_index = counters.len - 1;
+  }
+}
+
 void
 hb_buffer_t::add (hb_codepoint_t  codepoint,
 		  unsigned int    cluster)
@@ -715,6 +736,8 @@ hb_buffer_create (void)
 
   buffer->max_len = HB_BUFFER_MAX_LEN_DEFAULT;
   buffer->max_ops = HB_BUFFER_MAX_OPS_DEFAULT;
+  buffer->lookup_counters[0].init ();
+  buffer->lookup_counters[1].init ();
 
   buffer->reset ();
 
@@ -773,8 +796,12 @@ hb_buffer_destroy (hb_buffer_t *buffer)
 
   free (buffer->info);
   free (buffer->pos);
+  buffer->lookup_counters[0].fini ();
+  buffer->lookup_counters[1].fini ();
   if (buffer->message_destroy)
     buffer->message_destroy (buffer->message_data);
+  if (buffer->trace_destroy)
+    buffer->trace_destroy (buffer->trace_data);
 
   free (buffer);
 }
@@ -1283,6 +1310,38 @@ hb_buffer_allocation_successful (hb_buffer_t  *buffer)
   return buffer->successful;
 }
 
+/**
+ * hb_buffer_get_memory_usage:
+ * @buffer: an #hb_buffer_t.
+ * @usage_count: (inout) (optional): input length of @usage array, output
+ *               number of items written.
+ * @usage: (out) (array length=usage_count) (optional): array to write the
+ *         usage of each subsystem into.
+ *
+ * Reports the heap memory used by @buffer, per subsystem.  Clearing or
+ * resetting a buffer keeps its arrays allocated for reuse.
+ *
+ * Return value: total heap memory used by @buffer, in bytes, including
+ * subsystems that did not fit in @usage.
+ *
+ * Since: REPLACEME
+ **/
+unsigned int
+hb_buffer_get_memory_usage (hb_buffer_t       *buffer,
+			    unsigned int      *usage_count, /* IN/OUT */
+			    hb_memory_usage_t *usage /* OUT */)
+{
+  hb_memory_usage_accumulator_t c (usage_count, usage);
+  if (unlikely (hb_object_is_inert (buffer)))
+    return 0;
+
+  c.add (HB_MEMORY_USAGE_OBJECT, sizeof (*buffer));
+  c.add (HB_MEMORY_USAGE_GLYPH_INFOS, buffer->allocated * sizeof (buffer->info[0]));
+  c.add (HB_MEMORY_USAGE_GLYPH_POSITIONS, buffer->allocated * sizeof (buffer->pos[0]));
+
+  return c.total;
+}
+
 /**
  * hb_buffer_add:
  * @buffer: an #hb_buffer_t.
@@ -2020,6 +2079,77 @@ hb_buffer_set_message_func (hb_buffer_t *buffer,
   }
 }
 
+/**
+ * hb_buffer_get_lookup_counters:
+ * @buffer: an #hb_buffer_t.
+ * @table_tag: `GSUB` or `GPOS`.
+ * @start_offset: offset of the first lookup to retrieve.
+ * @counters_count: (inout) (optional): input length of @counters array,
+ *                  output number of items written.
+ * @counters: (out) (array length=counters_count) (optional): array to
+ *            write the counters of each lookup into.
+ *
+ * Fetches the counters collected while shaping @buffer with
+ * %HB_BUFFER_FLAG_COLLECT_COUNTERS set, indexed by lookup index.  Lookups
+ * that did not run have all counts zero.  Counters add up over shaping
+ * calls until the buffer is cleared or reset.
+ *
+ * Return value: total number of lookups counters are available for.
+ *
+ * Since: REPLACEME
+ **/
+unsigned int
+hb_buffer_get_lookup_counters (hb_buffer_t                 *buffer,
+			       hb_tag_t                     table_tag,
+			       unsigned int                 start_offset,
+			       unsigned int                *counters_count, /* IN/OUT */
+			       hb_buffer_lookup_counters_t *counters /* OUT */)
+{
+  const hb_vector_t<hb_buffer_lookup_counters_t> *table_counters;
+  switch (table_tag)
+  {
+    case HB_TAG ('G','S','U','B'): table_counters = &buffer->lookup_counters[0]; break;
+    case HB_TAG ('G','P','O','S'): table_counters = &buffer->lookup_counters[1]; break;
+    default:
+      if (counters_count)
+	*counters_count = 0;
+      return 0;
+  }
+
+  unsigned int len = table_counters->len;
+  if (counters_count)
+  {
+    if (start_offset > len)
+      *counters_count = 0;
+    else
+    {
+      unsigned int count = MIN (*counters_count, len - start_offset);
+      for (unsigned int i = 0; i < count; i++)
+	counters[i] = (*table_counters)[start_offset + i];
+      *counters_count = count;
+    }
+  }
+  return len;
+}
+
+/**
+ * hb_buffer_get_decomposition_count:
+ * @buffer: an #hb_buffer_t.
+ *
+ * Fetches how many characters normalization decomposed while shaping
+ * @buffer with %HB_BUFFER_FLAG_COLLECT_COUNTERS set.  Adds up over shaping
+ * calls until the buffer is cleared or reset.
+ *
+ * Return value: number of characters decomposed.
+ *
+ * Since: REPLACEME
+ **/
+unsigned int
+hb_buffer_get_decomposition_count (hb_buffer_t *buffer)
+{
+  return buffer->decompositions;
+}
+
 bool
 hb_buffer_t::message_impl (hb_font_t *font, const char *fmt, va_list ap)
 {
@@ -2027,3 +2157,46 @@ hb_buffer_t::message_impl (hb_font_t *font, const char *fmt, va_list ap)
   vsnprintf (buf, sizeof (buf),  fmt, ap);
   return (bool) this->message_func (this, font, buf, this->message_data);
 }
+
+/**
+ * hb_buffer_set_trace_func:
+ * @buffer: an #hb_buffer_t.
+ * @func: (closure user_data) (destroy destroy) (scope notified):
+ * @user_data:
+ * @destroy:
+ *
+ * Sets a function to call at the beginning and end of each shaping stage,
+ * with a timestamp, such that the time each stage takes can be measured.
+ * Pass %NULL to stop tracing.
+ *
+ * Since: REPLACEME
+ **/
+void
+hb_buffer_set_trace_func (hb_buffer_t            *buffer,
+			  hb_buffer_trace_func_t  func,
+			  void                   *user_data,
+			  hb_destroy_func_t       destroy)
+{
+  if (unlikely (hb_object_is_inert (buffer)))
+    return;
+
+  if (buffer->trace_destroy)
+    buffer->trace_destroy (buffer->trace_data);
+
+  if (func) {
+    buffer->trace_func = func;
+    buffer->trace_data = user_data;
+    buffer->trace_destroy = destroy;
+  } else {
+    buffer->trace_func = nullptr;
+    buffer->trace_data = nullptr;
+    buffer->trace_destroy = nullptr;
+  }
+}
+
+void
+hb_buffer_t::trace_impl (hb_font_t *font, hb_buffer_trace_event_t event,
+			 const char *stage, unsigned int stage_index)
+{
+  this->trace_func (this, font, event, stage, stage_index, _hb_time_ns (), this->trace_data);
+}
@@ -281,6 +281,13 @@ hb_buffer_guess_segment_properties (hb_buffer_t *buffer);
  *                      space glyph and zeroing the advance width.)
  *                      @HB_BUFFER_FLAG_PRESERVE_DEFAULT_IGNORABLES takes
  *                      precedence over this flag. Since: 1.8.0
+ * @HB_BUFFER_FLAG_COLLECT_COUNTERS:
+ *                      flag indicating that shaping should count the work
+ *                      done by each lookup; see
+ *                      hb_buffer_get_lookup_counters().  Ignored if the
+ *                      library was built with `HB_NO_BUFFER_COUNTERS`, as
+ *                      by `--disable-buffer-counters`.
+ *                      Since: REPLACEME
  *
  * Since: 0.9.20
  */
@@ -289,7 +296,8 @@ typedef enum { /*< flags >*/
   HB_BUFFER_FLAG_BOT				= 0x00000001u, /* Beginning-of-text */
   HB_BUFFER_FLAG_EOT				= 0x00000002u, /* End-of-text */
   HB_BUFFER_FLAG_PRESERVE_DEFAULT_IGNORABLES	= 0x00000004u,
-  HB_BUFFER_FLAG_REMOVE_DEFAULT_IGNORABLES	= 0x00000008u
+  HB_BUFFER_FLAG_REMOVE_DEFAULT_IGNORABLES	= 0x00000008u,
+  HB_BUFFER_FLAG_COLLECT_COUNTERS		= 0x00000010u
 } hb_buffer_flags_t;
 
 HB_EXTERN void
@@ -363,6 +371,11 @@ hb_buffer_pre_allocate (hb_buffer_t  *buffer,
 HB_EXTERN hb_bool_t
 hb_buffer_allocation_successful (hb_buffer_t  *buffer);
 
+HB_EXTERN unsigned int
+hb_buffer_get_memory_usage (hb_buffer_t       *buffer,
+			    unsigned int      *usage_count, /* IN/OUT */
+			    hb_memory_usage_t *usage /* OUT */);
+
 HB_EXTERN void
 hb_buffer_reverse (hb_buffer_t *buffer);
 
@@ -572,6 +585,91 @@ hb_buffer_set_message_func (hb_buffer_t *buffer,
 			    hb_buffer_message_func_t func,
 			    void *user_data, hb_destroy_func_t destroy);
 
+/**
+ * hb_buffer_trace_event_t:
+ * @HB_BUFFER_TRACE_EVENT_BEGIN: a stage begins.
+ * @HB_BUFFER_TRACE_EVENT_END: a stage ends.
+ *
+ * Since: REPLACEME
+ */
+typedef enum {
+  HB_BUFFER_TRACE_EVENT_BEGIN,
+  HB_BUFFER_TRACE_EVENT_END
+} hb_buffer_trace_event_t;
+
+/**
+ * hb_buffer_trace_func_t:
+ * @buffer: the buffer being shaped.
+ * @font: the font being shaped with.
+ * @event: whether @stage begins or ends.
+ * @stage: name of the stage, such as "normalize" or "GSUB".
+ * @stage_index: index of the stage among the GSUB or GPOS stages of the
+ *               shape plan; zero for other stages.
+ * @timestamp: monotonic time of the event, in nanoseconds.
+ * @user_data: user data passed to hb_buffer_set_trace_func().
+ *
+ * Called at the beginning and end of each stage of shaping with the
+ * OpenType shaper.  Stages nest; a stage ends before the stage it is part
+ * of does.
+ *
+ * Since: REPLACEME
+ */
+typedef void (*hb_buffer_trace_func_t) (hb_buffer_t             *buffer,
+					hb_font_t               *font,
+					hb_buffer_trace_event_t  event,
+					const char              *stage,
+					unsigned int             stage_index,
+					uint64_t                 timestamp,
+					void                    *user_data);
+
+HB_EXTERN void
+hb_buffer_set_trace_func (hb_buffer_t            *buffer,
+			  hb_buffer_trace_func_t  func,
+			  void                   *user_data,
+			  hb_destroy_func_t       destroy);
+
+/**
+ * hb_buffer_lookup_counters_t:
+ * @table_tag: the table of the lookup, `GSUB` or `GPOS`.
+ * @lookup_index: the index of the lookup in its table.
+ * @visits: times the lookup was run on the buffer, or called by a
+ *          contextual lookup.
+ * @subtables_tried: subtables tried on glyphs the lookup was run on;
+ *                   not counted for calls by contextual lookups.
+ * @digest_rejects: glyphs skipped because the lookup cannot apply to them.
+ * @applies: times the lookup applied.
+ * @glyphs_inserted: glyphs output by multiple substitutions.
+ * @glyphs_removed: glyphs deleted, replaced by the output of multiple
+ *                  substitutions, or merged into ligatures.
+ * @skippy_steps: glyphs stepped over while matching input and context.
+ *
+ * Counts the work one lookup did while shaping a buffer with
+ * %HB_BUFFER_FLAG_COLLECT_COUNTERS set.
+ *
+ * Since: REPLACEME
+ */
+typedef struct hb_buffer_lookup_counters_t {
+  hb_tag_t     table_tag;
+  unsigned int lookup_index;
+  unsigned int visits;
+  unsigned int subtables_tried;
+  unsigned int digest_rejects;
+  unsigned int applies;
+  unsigned int glyphs_inserted;
+  unsigned int glyphs_removed;
+  unsigned int skippy_steps;
+} hb_buffer_lookup_counters_t;
+
+HB_EXTERN unsigned int
+hb_buffer_get_lookup_counters (hb_buffer_t                 *buffer,
+			       hb_tag_t                     table_tag,
+			       unsigned int                 start_offset,
+			       unsigned int                *counters_count, /* IN/OUT */
+			       hb_buffer_lookup_counters_t *counters /* OUT */);
+
+HB_EXTERN unsigned int
+hb_buffer_get_decomposition_count (hb_buffer_t *buffer);
+
 
 HB_END_DECLS
 
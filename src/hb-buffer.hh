@@ -32,6 +32,7 @@
 
 #include "hb.hh"
 #include "hb-unicode.hh"
+#include "hb-vector.hh"
 
 
 #ifndef HB_BUFFER_MAX_LEN_FACTOR
@@ -79,6 +80,19 @@ enum hb_buffer_scratch_flags_t {
 HB_MARK_AS_FLAG_T (hb_buffer_scratch_flags_t);
 
 
+/*
+ * Counters.
+ */
+
+/* Adds n to a field of an hb_buffer_lookup_counters_t, if not nullptr. */
+#ifndef HB_NO_BUFFER_COUNTERS
+#define HB_BUFFER_COUNT(counters, field, n) \
+	HB_STMT_START { if (unlikely (counters)) (counters)->field += (n); } HB_STMT_END
+#else
+#define HB_BUFFER_COUNT(counters, field, n) HB_STMT_START { (void) (n); } HB_STMT_END
+#endif
+
+
 /*
  * hb_buffer_t
  */
@@ -128,6 +142,13 @@ struct hb_buffer_t
   hb_buffer_message_func_t message_func;
   void *message_data;
   hb_destroy_func_t message_destroy;
+  hb_buffer_trace_func_t trace_func;
+  void *trace_data;
+  hb_destroy_func_t trace_destroy;
+
+  /* Counters; see HB_BUFFER_FLAG_COLLECT_COUNTERS. */
+  hb_vector_t<hb_buffer_lookup_counters_t> lookup_counters[2]; /* GSUB/GPOS */
+  unsigned int decompositions;
 
   /* Internal debugging. */
   /* The bits here reflect current allocations of the bytes in glyph_info_t's var1 and var2. */
@@ -364,6 +385,38 @@ struct hb_buffer_t
   }
   HB_INTERNAL bool message_impl (hb_font_t *font, const char *fmt, va_list ap) HB_PRINTF_FUNC(3, 0);
 
+  inline void trace (hb_font_t *font, hb_buffer_trace_event_t event,
+		     const char *stage, unsigned int stage_index = 0)
+  {
+    if (unlikely (trace_func))
+      trace_impl (font, event, stage, stage_index);
+  }
+  inline void trace_begin (hb_font_t *font, const char *stage, unsigned int stage_index = 0)
+  { trace (font, HB_BUFFER_TRACE_EVENT_BEGIN, stage, stage_index); }
+  inline void trace_end (hb_font_t *font, const char *stage, unsigned int stage_index = 0)
+  { trace (font, HB_BUFFER_TRACE_EVENT_END, stage, stage_index); }
+  HB_INTERNAL void trace_impl (hb_font_t *font, hb_buffer_trace_event_t event,
+			       const char *stage, unsigned int stage_index);
+
+  inline bool collecting_counters (void) const
+  {
+#ifndef HB_NO_BUFFER_COUNTERS
+    return unlikely (flags & HB_BUFFER_FLAG_COLLECT_COUNTERS);
+#else
+    return false;
+#endif
+  }
+  /* Makes room for the counters of every lookup in the table, such that
+   * pointers returned by get_lookup_counters() stay valid while shaping. */
+  HB_INTERNAL void prepare_lookup_counters (unsigned int table_index, unsigned int lookup_count);
+  inline hb_buffer_lookup_counters_t *get_lookup_counters (unsigned int table_index,
+							   unsigned int lookup_index)
+  {
+    if (!collecting_counters () || lookup_index >= lookup_counters[table_index].len)
+      return nullptr;
+    return &lookup_counters[table_index][lookup_index];
+  }
+
   static inline void
   set_cluster (hb_glyph_info_t &inf, unsigned int cluster, unsigned int mask = 0)
   {
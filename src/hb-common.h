@@ -444,6 +444,71 @@ HB_EXTERN void
 hb_variation_to_string (hb_variation_t *variation,
 			char *buf, unsigned int size);
 
+/**
+ * hb_memory_usage_t:
+ * @subsystem: the subsystem using the memory; a table tag for the table
+ *             accelerators of a face, one of the `HB_MEMORY_USAGE_*` tags
+ *             otherwise.
+ * @bytes: heap memory used by the subsystem.
+ *
+ * Heap memory used by one subsystem of an object.
+ *
+ * Since: REPLACEME
+ */
+typedef struct hb_memory_usage_t {
+  hb_tag_t      subsystem;
+  unsigned int  bytes;
+} hb_memory_usage_t;
+
+/**
+ * HB_MEMORY_USAGE_OBJECT:
+ *
+ * The object itself, and the small allocations it owns.
+ *
+ * Since: REPLACEME
+ */
+#define HB_MEMORY_USAGE_OBJECT		HB_TAG ('o','b','j','t')
+/**
+ * HB_MEMORY_USAGE_SHAPE_PLANS:
+ *
+ * The shape plans cached on a face.
+ *
+ * Since: REPLACEME
+ */
+#define HB_MEMORY_USAGE_SHAPE_PLANS	HB_TAG ('p','l','n','s')
+/**
+ * HB_MEMORY_USAGE_LOOKUP_MAP:
+ *
+ * The features and lookups a shape plan applies.
+ *
+ * Since: REPLACEME
+ */
+#define HB_MEMORY_USAGE_LOOKUP_MAP	HB_TAG ('l','m','a','p')
+/**
+ * HB_MEMORY_USAGE_GLYPH_INFOS:
+ *
+ * The glyph info arrays of a buffer.
+ *
+ * Since: REPLACEME
+ */
+#define HB_MEMORY_USAGE_GLYPH_INFOS	HB_TAG ('i','n','f','o')
+/**
+ * HB_MEMORY_USAGE_GLYPH_POSITIONS:
+ *
+ * The glyph position arrays of a buffer.
+ *
+ * Since: REPLACEME
+ */
+#define HB_MEMORY_USAGE_GLYPH_POSITIONS	HB_TAG ('p','o','s',' ')
+/**
+ * HB_MEMORY_USAGE_SUBSET_CLOSURES:
+ *
+ * The glyph closures the subsetter caches on a face.
+ *
+ * Since: REPLACEME
+ */
+#define HB_MEMORY_USAGE_SUBSET_CLOSURES	HB_TAG ('s','u','b','c')
+
 
 HB_END_DECLS
 
@@ -30,9 +30,19 @@
 
 #include "hb-face.hh"
 #include "hb-blob.hh"
+#include "hb-mutex.hh"
+#include "hb-time.hh"
+#include "hb-vector.hh"
 #include "hb-open-file.hh"
 #include "hb-ot-face.hh"
 #include "hb-ot-cmap-table.hh"
+#include "hb-ot-glyf-table.hh"
+#include "hb-ot-hmtx-table.hh"
+#include "hb-ot-kern-table.hh"
+#include "hb-ot-post-table.hh"
+#include "hb-ot-layout.hh"
+#include "hb-ot-layout-gsub-table.hh"
+#include "hb-ot-layout-gpos-table.hh"
 
 
 /**
@@ -74,11 +84,14 @@ DEFINE_NULL_INSTANCE (hb_face_t) =
   nullptr, /* reference_table_func */
   nullptr, /* user_data */
   nullptr, /* destroy */
+  false, /* for_data */
 
   0,    /* index */
   1000, /* upem */
   0,    /* num_glyphs */
 
+  nullptr, /* trust */
+
   {
 #define HB_SHAPER_IMPLEMENT(shaper) HB_ATOMIC_PTR_INIT (HB_SHAPER_DATA_INVALID),
 #include "hb-shaper-list.hh"
@@ -86,6 +99,8 @@ DEFINE_NULL_INSTANCE (hb_face_t) =
   },
 
   HB_ATOMIC_PTR_INIT (nullptr), /* shape_plans */
+
+  HB_ATOMIC_PTR_INIT (nullptr), /* caches */
 };
 
 
@@ -203,6 +218,7 @@ hb_face_create (hb_blob_t    *blob,
 				    _hb_face_for_data_closure_destroy);
 
   face->index = index;
+  face->for_data = true;
 
   return face;
 }
@@ -260,6 +276,13 @@ hb_face_destroy (hb_face_t *face)
     node = next;
   }
 
+  for (hb_face_t::cache_node_t *node = face->caches.get (); node; )
+  {
+    hb_face_t::cache_node_t *next = node->next;
+    free (node);
+    node = next;
+  }
+
 #define HB_SHAPER_IMPLEMENT(shaper) HB_SHAPER_DATA_DESTROY(shaper, face);
 #include "hb-shaper-list.hh"
 #undef HB_SHAPER_IMPLEMENT
@@ -267,6 +290,12 @@ hb_face_destroy (hb_face_t *face)
   if (face->destroy)
     face->destroy (face->user_data);
 
+  if (face->trust)
+  {
+    face->trust->fini ();
+    free (face->trust);
+  }
+
   free (face);
 }
 
@@ -487,6 +516,15 @@ hb_face_get_glyph_count (const hb_face_t *face)
   return face->get_num_glyphs ();
 }
 
+struct hb_face_builder_data_t;
+static void
+_hb_face_builder_data_destroy (void *user_data);
+static unsigned int
+_hb_face_builder_data_get_table_tags (hb_face_builder_data_t *data,
+				      unsigned int            start_offset,
+				      unsigned int           *table_count,
+				      hb_tag_t               *table_tags);
+
 /**
  * hb_face_get_table_tags:
  * @face: a face.
@@ -494,7 +532,9 @@ hb_face_get_glyph_count (const hb_face_t *face)
  * @table_count: input length of @table_tags array, output number of items written.
  * @table_tags: array to write tags into.
  *
- * Retrieves table tags for a face, if possible.
+ * Retrieves table tags for a face, if possible.  For a face created using
+ * hb_face_builder_create(), these are the tags of the tables added so far,
+ * in the order they were added.
  *
  * Return value: total number of tables, or 0 if not possible to list.
  *
@@ -506,6 +546,10 @@ hb_face_get_table_tags (const hb_face_t *face,
 			unsigned int *table_count, /* IN/OUT */
 			hb_tag_t     *table_tags /* OUT */)
 {
+  if (face->destroy == (hb_destroy_func_t) _hb_face_builder_data_destroy)
+    return _hb_face_builder_data_get_table_tags ((hb_face_builder_data_t *) face->user_data,
+						 start_offset, table_count, table_tags);
+
   if (face->destroy != (hb_destroy_func_t) _hb_face_for_data_closure_destroy)
   {
     if (table_count)
@@ -522,6 +566,103 @@ hb_face_get_table_tags (const hb_face_t *face,
 }
 
 
+/*
+ * Trusted tables.
+ */
+
+/**
+ * hb_face_set_trusted_tables:
+ * @face: a face.
+ * @digests: (array length=digests_count): digests of the tables to trust.
+ * @digests_count: number of @digests.
+ *
+ * Puts @face in trusted-tables mode.  Tables of @face whose length and
+ * checksum match one of @digests are used without being sanitized.  This
+ * is only safe if the fonts in use come from a fixed, validated set; the
+ * checksum is no protection against crafted data.
+ *
+ * In trusted-tables mode, @face also records the digest of every table
+ * that passes sanitization; see hb_face_get_sanitized_tables().  Saving
+ * those and passing them back to this function, possibly in a later
+ * process, caches the sanitization result across runs.  Passing no
+ * @digests enables recording only.
+ *
+ * Must be called before the face is used.  Replaces previously set
+ * digests.
+ *
+ * Return value: false if allocation failed, true otherwise.
+ *
+ * Since: REPLACEME
+ **/
+hb_bool_t
+hb_face_set_trusted_tables (hb_face_t                    *face,
+			    const hb_face_table_digest_t *digests,
+			    unsigned int                  digests_count)
+{
+  if (face->immutable)
+    return false;
+
+  if (!face->trust)
+  {
+    hb_face_trust_t *trust = (hb_face_trust_t *) calloc (1, sizeof (hb_face_trust_t));
+    if (unlikely (!trust))
+      return false;
+    trust->init ();
+    face->trust = trust;
+  }
+
+  hb_lock_t lock (face->trust->lock);
+  if (unlikely (!face->trust->trusted.resize (digests_count)))
+    return false;
+  if (digests_count)
+    memcpy (face->trust->trusted.arrayZ (), digests, digests_count * sizeof (digests[0]));
+  return true;
+}
+
+/**
+ * hb_face_get_sanitized_tables:
+ * @face: a face.
+ * @start_offset: index of first digest to return.
+ * @digests_count: (inout) (optional): input length of @digests array,
+ *                 output number of items written.
+ * @digests: (out) (array length=digests_count) (optional): array to write
+ *           digests into.
+ *
+ * Retrieves the digests of the tables of @face that were sanitized
+ * successfully so far.  Only recorded in trusted-tables mode; see
+ * hb_face_set_trusted_tables().
+ *
+ * Return value: total number of digests recorded.
+ *
+ * Since: REPLACEME
+ **/
+unsigned int
+hb_face_get_sanitized_tables (const hb_face_t        *face,
+			      unsigned int            start_offset,
+			      unsigned int           *digests_count, /* IN/OUT */
+			      hb_face_table_digest_t *digests /* OUT */)
+{
+  hb_face_trust_t *trust = face->trust;
+  if (!trust)
+  {
+    if (digests_count)
+      *digests_count = 0;
+    return 0;
+  }
+
+  hb_lock_t lock (trust->lock);
+  unsigned int total = trust->sanitized.len;
+  if (digests_count)
+  {
+    unsigned int count = start_offset < total ? MIN (*digests_count, total - start_offset) : 0;
+    for (unsigned int i = 0; i < count; i++)
+      digests[i] = trust->sanitized[start_offset + i];
+    *digests_count = count;
+  }
+  return total;
+}
+
+
 /*
  * Character set.
  */
@@ -579,6 +720,369 @@ hb_face_collect_variation_unicodes (hb_face_t *face,
 
 
 
+/*
+ * Prewarming.
+ */
+
+struct hb_face_prewarm_task_t
+{
+  hb_face_prewarm_flags_t part;
+  unsigned int start, end; /* Lookup range, for GSUB / GPOS lookup tasks. */
+};
+
+struct hb_face_prewarm_closure_t
+{
+  hb_face_t *face;
+  hb_vector_t<hb_face_prewarm_task_t> tasks;
+};
+
+/* Lookups per task, when building lookup accelerators. */
+#define HB_FACE_PREWARM_LOOKUPS_PER_TASK 32
+
+template <typename T>
+static void
+_hb_face_prewarm_lookups (const T &accel, unsigned int start, unsigned int end)
+{
+  for (unsigned int i = start; i < end; i++)
+    accel.get_accel (i);
+}
+
+static void
+_hb_face_prewarm_task (void *task_data, unsigned int task_index)
+{
+  hb_face_prewarm_closure_t *closure = (hb_face_prewarm_closure_t *) task_data;
+  const hb_face_prewarm_task_t &task = closure->tasks[task_index];
+  hb_ot_face_data_t *data = hb_ot_face_data (closure->face);
+
+  switch (task.part)
+  {
+    case HB_FACE_PREWARM_FLAG_CMAP:
+      data->cmap.get ();
+      break;
+    case HB_FACE_PREWARM_FLAG_METRICS:
+      data->hmtx.get ();
+      data->vmtx.get ();
+      break;
+    case HB_FACE_PREWARM_FLAG_GLYF:
+      data->glyf.get ();
+      break;
+    case HB_FACE_PREWARM_FLAG_GDEF:
+      _get_gdef_accel (closure->face);
+      break;
+    case HB_FACE_PREWARM_FLAG_GSUB:
+      if (task.start < task.end)
+	_hb_face_prewarm_lookups (*data->GSUB, task.start, task.end);
+      else
+	data->GSUB.get ();
+      break;
+    case HB_FACE_PREWARM_FLAG_GPOS:
+      if (task.start < task.end)
+	_hb_face_prewarm_lookups (*data->GPOS, task.start, task.end);
+      else
+	data->GPOS.get ();
+      break;
+    case HB_FACE_PREWARM_FLAG_KERN:
+      data->kern.get ();
+      break;
+    case HB_FACE_PREWARM_FLAG_POST:
+      data->post->get_gids_sorted_by_name ();
+      break;
+    default:
+      break;
+  }
+}
+
+static void
+_hb_face_prewarm_add_lookup_tasks (hb_face_prewarm_closure_t *closure,
+				   hb_face_prewarm_flags_t    part,
+				   unsigned int               lookup_count)
+{
+  for (unsigned int start = 0; start < lookup_count; start += HB_FACE_PREWARM_LOOKUPS_PER_TASK)
+  {
+    hb_face_prewarm_task_t task = {part, start, MIN (start + HB_FACE_PREWARM_LOOKUPS_PER_TASK, lookup_count)};
+    closure->tasks.push (task);
+  }
+}
+
+static void
+_hb_face_run_tasks (hb_face_prewarm_closure_t  *closure,
+		    hb_face_task_runner_func_t  runner,
+		    void                       *user_data)
+{
+  if (unlikely (closure->tasks.in_error ()) || !closure->tasks.len)
+    return;
+
+  if (runner)
+    runner (_hb_face_prewarm_task, closure, closure->tasks.len, user_data);
+  else
+    for (unsigned int i = 0; i < closure->tasks.len; i++)
+      _hb_face_prewarm_task (closure, i);
+}
+
+static unsigned int
+_hb_face_prewarm_part_memory_usage (hb_face_t *face, hb_face_prewarm_flags_t part)
+{
+  hb_ot_face_data_t *data = hb_ot_face_data (face);
+
+  /* The accelerators themselves are heap-allocated as well. */
+  switch (part)
+  {
+    case HB_FACE_PREWARM_FLAG_CMAP:
+      return sizeof (*data->cmap.get ());
+    case HB_FACE_PREWARM_FLAG_METRICS:
+      return sizeof (*data->hmtx.get ()) + sizeof (*data->vmtx.get ());
+    case HB_FACE_PREWARM_FLAG_GLYF:
+      return sizeof (*data->glyf.get ());
+    case HB_FACE_PREWARM_FLAG_GDEF:
+      return sizeof (OT::GDEF_accelerator_t) + _get_gdef_accel (face).get_memory_usage ();
+    case HB_FACE_PREWARM_FLAG_GSUB:
+      return sizeof (*data->GSUB.get ()) + data->GSUB->get_memory_usage ();
+    case HB_FACE_PREWARM_FLAG_GPOS:
+      return sizeof (*data->GPOS.get ()) + data->GPOS->get_memory_usage ();
+    case HB_FACE_PREWARM_FLAG_KERN:
+      return sizeof (*data->kern.get ()) + data->kern->get_memory_usage ();
+    case HB_FACE_PREWARM_FLAG_POST:
+      return sizeof (*data->post.get ()) + data->post->get_memory_usage ();
+    default:
+      return 0;
+  }
+}
+
+/**
+ * hb_face_prewarm:
+ * @face: a face.
+ * @flags: parts of @face to prewarm.
+ * @parts_count: (inout) (optional): input length of @parts array, output
+ *               number of items written.
+ * @parts: (out) (array length=parts_count) (optional): array to write
+ *         reports on the prewarmed parts into.
+ *
+ * Loads, sanitizes and builds the accelerators for the parts of @face
+ * selected by @flags on the calling thread, which otherwise happens when
+ * each is first needed, typically during the first shaping call.  Reports
+ * how long each part took and how much heap memory it uses; table data is
+ * not counted, as it normally is not copied out of the font blob.  Parts
+ * that were warm already report their memory, and close to no time.
+ *
+ * Return value: the number of parts prewarmed.
+ *
+ * Since: REPLACEME
+ **/
+unsigned int
+hb_face_prewarm (hb_face_t               *face,
+		 hb_face_prewarm_flags_t  flags,
+		 unsigned int            *parts_count, /* IN/OUT */
+		 hb_face_prewarm_part_t  *parts /* OUT */)
+{
+  unsigned int count = 0;
+  unsigned int max_parts = parts_count ? *parts_count : 0;
+  if (parts_count)
+    *parts_count = 0;
+
+  if (unlikely (!hb_ot_shaper_face_data_ensure (face))) return 0;
+  hb_ot_face_data_t *data = hb_ot_face_data (face);
+
+  hb_face_prewarm_closure_t closure;
+  closure.face = face;
+  closure.tasks.init ();
+
+  for (unsigned int part = 1; part & HB_FACE_PREWARM_FLAG_ALL; part <<= 1)
+  {
+    if (!(flags & part))
+      continue;
+
+    uint64_t start = _hb_time_ns ();
+
+    closure.tasks.resize (0);
+    hb_face_prewarm_task_t task = {(hb_face_prewarm_flags_t) part, 0, 0};
+    closure.tasks.push (task);
+    _hb_face_run_tasks (&closure, nullptr, nullptr);
+    closure.tasks.resize (0);
+    if (part == HB_FACE_PREWARM_FLAG_GSUB)
+      _hb_face_prewarm_add_lookup_tasks (&closure, HB_FACE_PREWARM_FLAG_GSUB, data->GSUB->lookup_count);
+    if (part == HB_FACE_PREWARM_FLAG_GPOS)
+      _hb_face_prewarm_add_lookup_tasks (&closure, HB_FACE_PREWARM_FLAG_GPOS, data->GPOS->lookup_count);
+    _hb_face_run_tasks (&closure, nullptr, nullptr);
+
+    uint64_t end = _hb_time_ns ();
+
+    if (count < max_parts)
+    {
+      parts[count].part = (hb_face_prewarm_flags_t) part;
+      parts[count].nanoseconds = end - start;
+      parts[count].bytes = _hb_face_prewarm_part_memory_usage (face, (hb_face_prewarm_flags_t) part);
+      *parts_count = count + 1;
+    }
+    count++;
+  }
+
+  closure.tasks.fini ();
+  return count;
+}
+
+/**
+ * hb_face_prewarm_parallel:
+ * @face: a face.
+ * @flags: parts of @face to prewarm.
+ * @runner: (nullable): function to run independent tasks with.
+ * @user_data: data to pass to @runner.
+ *
+ * Loads, sanitizes and builds the accelerators for the parts of @face
+ * selected by @flags, which otherwise happens when each is first needed.
+ * The work is split into independent tasks that are handed to @runner,
+ * such that they can run concurrently on a thread pool of the caller's.
+ * HarfBuzz does not start threads of its own; if @runner is %NULL, the
+ * tasks are run one after the other on the calling thread.
+ *
+ * Results are published to @face as if they were built lazily, so it is
+ * safe for other threads to use @face meanwhile.
+ *
+ * Since: REPLACEME
+ **/
+void
+hb_face_prewarm_parallel (hb_face_t                  *face,
+			  hb_face_prewarm_flags_t     flags,
+			  hb_face_task_runner_func_t  runner,
+			  void                       *user_data)
+{
+  if (unlikely (!hb_ot_shaper_face_data_ensure (face))) return;
+
+  hb_face_prewarm_closure_t closure;
+  closure.face = face;
+  closure.tasks.init ();
+
+  /* Tables first, ... */
+  for (unsigned int part = 1; part & HB_FACE_PREWARM_FLAG_ALL; part <<= 1)
+    if (flags & part)
+    {
+      hb_face_prewarm_task_t task = {(hb_face_prewarm_flags_t) part, 0, 0};
+      closure.tasks.push (task);
+    }
+  _hb_face_run_tasks (&closure, runner, user_data);
+
+  /* ...then the lookups of GSUB and GPOS, which need those. */
+  closure.tasks.resize (0);
+  hb_ot_face_data_t *data = hb_ot_face_data (face);
+  if (flags & HB_FACE_PREWARM_FLAG_GSUB)
+    _hb_face_prewarm_add_lookup_tasks (&closure, HB_FACE_PREWARM_FLAG_GSUB, data->GSUB->lookup_count);
+  if (flags & HB_FACE_PREWARM_FLAG_GPOS)
+    _hb_face_prewarm_add_lookup_tasks (&closure, HB_FACE_PREWARM_FLAG_GPOS, data->GPOS->lookup_count);
+  _hb_face_run_tasks (&closure, runner, user_data);
+
+  closure.tasks.fini ();
+}
+
+
+/*
+ * Memory.
+ */
+
+static hb_ot_face_data_t *
+_hb_face_get_ot_face_data_if_created (hb_face_t *face)
+{
+  void *data = face->shaper_data.ot.get ();
+  if (!data || data == HB_SHAPER_DATA_INVALID || data == HB_SHAPER_DATA_SUCCEEDED)
+    return nullptr;
+  return (hb_ot_face_data_t *) data;
+}
+
+/**
+ * hb_face_get_memory_usage:
+ * @face: a face.
+ * @usage_count: (inout) (optional): input length of @usage array, output
+ *               number of items written.
+ * @usage: (out) (array length=usage_count) (optional): array to write the
+ *         usage of each subsystem into.
+ *
+ * Reports the heap memory used by @face, per subsystem: the face object,
+ * the accelerators of the tables loaded so far, under their table tags,
+ * the cached shape plans, and what the subsetter caches on @face.  Font
+ * data is not counted, and neither are shape plans that are referenced
+ * elsewhere but no longer cached.
+ *
+ * Return value: total heap memory used by @face, in bytes, including
+ * subsystems that did not fit in @usage.
+ *
+ * Since: REPLACEME
+ **/
+unsigned int
+hb_face_get_memory_usage (hb_face_t         *face,
+			  unsigned int      *usage_count, /* IN/OUT */
+			  hb_memory_usage_t *usage /* OUT */)
+{
+  hb_memory_usage_accumulator_t c (usage_count, usage);
+  if (unlikely (hb_object_is_inert (face)))
+    return 0;
+
+  c.add (HB_MEMORY_USAGE_OBJECT, sizeof (*face));
+  if (face->reference_table_func == _hb_face_for_data_reference_table)
+    c.add (HB_MEMORY_USAGE_OBJECT, sizeof (hb_face_for_data_closure_t));
+  if (face->trust)
+    c.add (HB_MEMORY_USAGE_OBJECT, sizeof (*face->trust) +
+				   face->trust->trusted.get_memory_usage () +
+				   face->trust->sanitized.get_memory_usage ());
+
+  hb_ot_face_data_t *data = _hb_face_get_ot_face_data_if_created (face);
+  if (data)
+    data->add_memory_usage (&c);
+
+  for (hb_face_t::plan_node_t *node = face->shape_plans.get (); node; node = node->next)
+    c.add (HB_MEMORY_USAGE_SHAPE_PLANS, sizeof (*node) +
+	   hb_shape_plan_get_memory_usage (node->shape_plan, nullptr, nullptr));
+
+  for (hb_face_t::cache_node_t *node = face->caches.get (); node; node = node->next)
+  {
+    c.add (HB_MEMORY_USAGE_OBJECT, sizeof (*node));
+    void *cache = hb_face_get_user_data (face, node->key);
+    if (cache)
+      c.add (node->subsystem, node->get_memory_usage (cache));
+  }
+
+  return c.total;
+}
+
+/**
+ * hb_face_drop_caches:
+ * @face: a face.
+ *
+ * Frees the table accelerators, shape plans and subset closures cached on
+ * @face.  They are built again as needed; the face stays usable, only
+ * slower to shape or subset with until then.  Useful to give memory back
+ * under pressure.
+ *
+ * Must not be called while another thread is using @face, or a font or
+ * shape plan created from it.
+ *
+ * Since: REPLACEME
+ **/
+void
+hb_face_drop_caches (hb_face_t *face)
+{
+  if (unlikely (hb_object_is_inert (face)))
+    return;
+
+  hb_face_t::plan_node_t *node;
+retry:
+  node = face->shape_plans.get ();
+  if (unlikely (!face->shape_plans.cmpexch (node, nullptr)))
+    goto retry;
+  while (node)
+  {
+    hb_face_t::plan_node_t *next = node->next;
+    hb_shape_plan_destroy (node->shape_plan);
+    free (node);
+    node = next;
+  }
+
+  hb_ot_face_data_t *data = _hb_face_get_ot_face_data_if_created (face);
+  if (data)
+    data->free_instances ();
+
+  for (hb_face_t::cache_node_t *cache = face->caches.get (); cache; cache = cache->next)
+    hb_face_set_user_data (face, cache->key, nullptr, nullptr, true);
+}
+
+
 /*
  * face-builder: A face that has add_table().
  */
@@ -626,6 +1130,30 @@ _hb_face_builder_data_destroy (void *user_data)
   free (data);
 }
 
+static unsigned int
+_hb_face_builder_data_get_table_tags (hb_face_builder_data_t *data,
+				      unsigned int            start_offset,
+				      unsigned int           *table_count,
+				      hb_tag_t               *table_tags)
+{
+  unsigned int total = data->tables.len;
+  if (table_count)
+  {
+    unsigned int count = start_offset < total ? MIN (*table_count, total - start_offset) : 0;
+    for (unsigned int i = 0; i < count; i++)
+      table_tags[i] = data->tables[start_offset + i].tag;
+    *table_count = count;
+  }
+  return total;
+}
+
+static hb_tag_t
+_hb_face_builder_data_get_sfnt_tag (hb_face_builder_data_t *data)
+{
+  bool is_cff = data->tables.lsearch (HB_TAG ('C','F','F',' ')) || data->tables.lsearch (HB_TAG ('C','F','F','2'));
+  return is_cff ? OT::OpenTypeFontFile::CFFTag : OT::OpenTypeFontFile::TrueTypeTag;
+}
+
 static hb_blob_t *
 _hb_face_builder_data_reference_blob (hb_face_builder_data_t *data)
 {
@@ -643,13 +1171,10 @@ _hb_face_builder_data_reference_blob (hb_face_builder_data_t *data)
   hb_serialize_context_t c (buf, face_length);
   OT::OpenTypeFontFile *f = c.start_serialize<OT::OpenTypeFontFile> ();
 
-  bool is_cff = data->tables.lsearch (HB_TAG ('C','F','F',' ')) || data->tables.lsearch (HB_TAG ('C','F','F','2'));
-  hb_tag_t sfnt_tag = is_cff ? OT::OpenTypeFontFile::CFFTag : OT::OpenTypeFontFile::TrueTypeTag;
-
   Supplier<hb_tag_t>    tags_supplier  (&data->tables[0].tag, table_count, sizeof (data->tables[0]));
   Supplier<hb_blob_t *> blobs_supplier (&data->tables[0].blob, table_count, sizeof (data->tables[0]));
   bool ret = f->serialize_single (&c,
-				  sfnt_tag,
+				  _hb_face_builder_data_get_sfnt_tag (data),
 				  tags_supplier,
 				  blobs_supplier,
 				  table_count);
@@ -725,3 +1250,78 @@ hb_face_builder_add_table (hb_face_t *face, hb_tag_t tag, hb_blob_t *blob)
 
   return true;
 }
+
+/**
+ * hb_face_builder_write:
+ * @face: a face created using hb_face_builder_create().
+ * @write_func: function to write the font data with.
+ * @user_data: data to pass to @write_func.
+ *
+ * Writes the binary font file that hb_face_reference_blob() would return
+ * for @face, in pieces, by calling @write_func repeatedly.  Only the table
+ * directory is assembled in memory; table data is written straight from
+ * the blobs added to @face, and checksums are computed from them.
+ *
+ * Return value: false if allocation failed or @write_func returned false,
+ * true otherwise.
+ *
+ * Since: REPLACEME
+ **/
+hb_bool_t
+hb_face_builder_write (hb_face_t            *face,
+		       hb_face_write_func_t  write_func,
+		       void                 *user_data)
+{
+  if (unlikely (face->destroy != (hb_destroy_func_t) _hb_face_builder_data_destroy))
+    return false;
+
+  hb_face_builder_data_t *data = (hb_face_builder_data_t *) face->user_data;
+  unsigned int table_count = data->tables.len;
+  unsigned int dir_length = table_count * 16 + 12;
+
+  char *dir = (char *) malloc (dir_length);
+  if (unlikely (!dir))
+    return false;
+
+  hb_serialize_context_t c (dir, dir_length);
+  OT::OpenTypeFontFile *f = c.start_serialize<OT::OpenTypeFontFile> ();
+
+  Supplier<hb_tag_t>    tags_supplier  (&data->tables[0].tag, table_count, sizeof (data->tables[0]));
+  Supplier<hb_blob_t *> blobs_supplier (&data->tables[0].blob, table_count, sizeof (data->tables[0]));
+  uint32_t checksum_adjustment;
+  bool ret = f->serialize_single_directory (&c,
+					    _hb_face_builder_data_get_sfnt_tag (data),
+					    tags_supplier,
+					    blobs_supplier,
+					    table_count,
+					    &checksum_adjustment);
+
+  c.end_serialize ();
+
+  ret = ret && write_func (dir, dir_length, user_data);
+  free (dir);
+
+  static const char padding[4] = {};
+  for (unsigned int i = 0; ret && i < table_count; i++)
+  {
+    unsigned int length;
+    const char *table = hb_blob_get_data (data->tables[i].blob, &length);
+    if (data->tables[i].tag == HB_OT_TAG_head && length >= OT::head::static_size)
+    {
+      /* Write head with its checkSumAdjustment, at offset 8, replaced. */
+      const unsigned int before = 8;
+      OT::HBUINT32 adjustment;
+      adjustment.set (checksum_adjustment);
+      ret = write_func (table, before, user_data) &&
+	    write_func ((const char *) &adjustment, 4, user_data) &&
+	    write_func (table + before + 4, length - before - 4, user_data);
+    }
+    else if (length)
+      ret = write_func (table, length, user_data);
+
+    if (ret && length % 4)
+      ret = write_func (padding, 4 - length % 4, user_data);
+  }
+
+  return ret;
+}
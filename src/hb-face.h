@@ -122,6 +122,39 @@ hb_face_get_table_tags (const hb_face_t *face,
 			hb_tag_t     *table_tags /* OUT */);
 
 
+/*
+ * Trusted tables.
+ */
+
+/**
+ * hb_face_table_digest_t:
+ * @tag: table tag.
+ * @length: table length, in bytes.
+ * @checksum: OpenType checksum of the table data.
+ *
+ * Identifies the contents of a font table.  See
+ * hb_face_set_trusted_tables().
+ *
+ * Since: REPLACEME
+ */
+typedef struct hb_face_table_digest_t {
+  hb_tag_t     tag;
+  unsigned int length;
+  uint32_t     checksum;
+} hb_face_table_digest_t;
+
+HB_EXTERN hb_bool_t
+hb_face_set_trusted_tables (hb_face_t                    *face,
+			    const hb_face_table_digest_t *digests,
+			    unsigned int                  digests_count);
+
+HB_EXTERN unsigned int
+hb_face_get_sanitized_tables (const hb_face_t        *face,
+			      unsigned int            start_offset,
+			      unsigned int           *digests_count, /* IN/OUT */
+			      hb_face_table_digest_t *digests /* OUT */);
+
+
 /*
  * Character set.
  */
@@ -140,6 +173,111 @@ hb_face_collect_variation_unicodes (hb_face_t *face,
 				    hb_set_t  *out);
 
 
+/*
+ * Prewarming.
+ */
+
+/**
+ * hb_face_prewarm_flags_t:
+ * @HB_FACE_PREWARM_FLAG_CMAP: the cmap table.
+ * @HB_FACE_PREWARM_FLAG_METRICS: the hmtx and vmtx tables.
+ * @HB_FACE_PREWARM_FLAG_GLYF: the glyf and loca tables.
+ * @HB_FACE_PREWARM_FLAG_GDEF: the GDEF table.
+ * @HB_FACE_PREWARM_FLAG_GSUB: the GSUB table and all its lookups.
+ * @HB_FACE_PREWARM_FLAG_GPOS: the GPOS table and all its lookups.
+ * @HB_FACE_PREWARM_FLAG_KERN: the kern table.
+ * @HB_FACE_PREWARM_FLAG_POST: the post table, including the glyph
+ * name index.
+ * @HB_FACE_PREWARM_FLAG_ALL: all of the above.
+ *
+ * Parts of a face to load and set up ahead of time.
+ *
+ * Since: REPLACEME
+ */
+typedef enum { /*< flags >*/
+  HB_FACE_PREWARM_FLAG_CMAP		= 0x00000001u,
+  HB_FACE_PREWARM_FLAG_METRICS		= 0x00000002u,
+  HB_FACE_PREWARM_FLAG_GLYF		= 0x00000004u,
+  HB_FACE_PREWARM_FLAG_GDEF		= 0x00000008u,
+  HB_FACE_PREWARM_FLAG_GSUB		= 0x00000010u,
+  HB_FACE_PREWARM_FLAG_GPOS		= 0x00000020u,
+  HB_FACE_PREWARM_FLAG_KERN		= 0x00000040u,
+  HB_FACE_PREWARM_FLAG_POST		= 0x00000080u,
+
+  HB_FACE_PREWARM_FLAG_ALL		= 0x000000FFu
+} hb_face_prewarm_flags_t;
+
+/**
+ * hb_face_prewarm_part_t:
+ * @part: the part, as a single flag.
+ * @nanoseconds: time taken to prewarm the part.
+ * @bytes: heap memory used by the part after prewarming.
+ *
+ * Reports on one part of a face; see hb_face_prewarm().
+ *
+ * Since: REPLACEME
+ */
+typedef struct hb_face_prewarm_part_t {
+  hb_face_prewarm_flags_t part;
+  uint64_t                nanoseconds;
+  unsigned int            bytes;
+} hb_face_prewarm_part_t;
+
+HB_EXTERN unsigned int
+hb_face_prewarm (hb_face_t               *face,
+		 hb_face_prewarm_flags_t  flags,
+		 unsigned int            *parts_count, /* IN/OUT */
+		 hb_face_prewarm_part_t  *parts /* OUT */);
+
+/**
+ * hb_face_task_func_t:
+ * @task_data: data to pass back.
+ * @task_index: index of the task to run.
+ *
+ * Since: REPLACEME
+ */
+typedef void (*hb_face_task_func_t) (void         *task_data,
+				     unsigned int  task_index);
+
+/**
+ * hb_face_task_runner_func_t:
+ * @task_func: function to run the tasks with.
+ * @task_data: data to pass to @task_func.
+ * @task_count: number of tasks.
+ * @user_data: data passed to hb_face_prewarm_parallel() or
+ *             hb_subset_parallel().
+ *
+ * Must call @task_func (@task_data, i) once for every i smaller than
+ * @task_count, in any order and on any threads, and return after all
+ * of those calls have returned.
+ *
+ * Since: REPLACEME
+ */
+typedef void (*hb_face_task_runner_func_t) (hb_face_task_func_t  task_func,
+					    void                *task_data,
+					    unsigned int         task_count,
+					    void                *user_data);
+
+HB_EXTERN void
+hb_face_prewarm_parallel (hb_face_t                  *face,
+			  hb_face_prewarm_flags_t     flags,
+			  hb_face_task_runner_func_t  runner,
+			  void                       *user_data);
+
+
+/*
+ * Memory.
+ */
+
+HB_EXTERN unsigned int
+hb_face_get_memory_usage (hb_face_t         *face,
+			  unsigned int      *usage_count, /* IN/OUT */
+			  hb_memory_usage_t *usage /* OUT */);
+
+HB_EXTERN void
+hb_face_drop_caches (hb_face_t *face);
+
+
 /*
  * Builder face.
  */
@@ -152,6 +290,25 @@ hb_face_builder_add_table (hb_face_t *face,
 			   hb_tag_t   tag,
 			   hb_blob_t *blob);
 
+/**
+ * hb_face_write_func_t:
+ * @data: bytes to write.
+ * @length: number of bytes in @data.
+ * @user_data: data passed to hb_face_builder_write().
+ *
+ * Return value: true if all of @data was written, false to stop writing.
+ *
+ * Since: REPLACEME
+ */
+typedef hb_bool_t (*hb_face_write_func_t) (const char   *data,
+					   unsigned int  length,
+					   void         *user_data);
+
+HB_EXTERN hb_bool_t
+hb_face_builder_write (hb_face_t            *face,
+		       hb_face_write_func_t  write_func,
+		       void                 *user_data);
+
 
 HB_END_DECLS
 
@@ -33,12 +33,53 @@
 
 #include "hb-shaper.hh"
 #include "hb-shape-plan.hh"
+#include "hb-mutex.hh"
+#include "hb-vector.hh"
 
 
 /*
  * hb_face_t
  */
 
+/* See hb_face_set_trusted_tables(). */
+struct hb_face_trust_t
+{
+  struct table_t
+  {
+    hb_tag_t tag;
+    hb_blob_t *blob;
+  };
+
+  hb_mutex_t lock;
+  hb_vector_t<hb_face_table_digest_t> trusted;
+  hb_vector_t<hb_face_table_digest_t> sanitized;
+
+  /* If set, tables that pass sanitization are kept and handed out again
+   * instead of being sanitized anew, and no digests are recorded.  See
+   * _hb_face_keep_sanitized_tables(). */
+  bool keep_sanitized;
+  hb_vector_t<table_t> sanitized_tables;
+
+  inline void init (void)
+  {
+    lock.init ();
+    trusted.init ();
+    sanitized.init ();
+    keep_sanitized = false;
+    sanitized_tables.init ();
+  }
+
+  inline void fini (void)
+  {
+    for (unsigned int i = 0; i < sanitized_tables.len; i++)
+      hb_blob_destroy (sanitized_tables[i].blob);
+    sanitized_tables.fini ();
+    sanitized.fini ();
+    trusted.fini ();
+    lock.fini ();
+  }
+};
+
 struct hb_face_t
 {
   hb_object_header_t header;
@@ -49,11 +90,15 @@ struct hb_face_t
   hb_reference_table_func_t  reference_table_func;
   void                      *user_data;
   hb_destroy_func_t          destroy;
+  hb_bool_t                  for_data;	/* Made by hb_face_create(); reference_table_func
+					 * is then _hb_face_for_data_reference_table(). */
 
   unsigned int index;			/* Face index in a collection, zero-based. */
   mutable unsigned int upem;		/* Units-per-EM. */
   mutable unsigned int num_glyphs;	/* Number of glyphs. */
 
+  struct hb_face_trust_t *trust;	/* Trusted tables; see hb_face_set_trusted_tables(). */
+
   struct hb_shaper_data_t shaper_data;	/* Various shaper data. */
 
   /* Cache */
@@ -64,6 +109,18 @@ struct hb_face_t
   };
   hb_atomic_ptr_t<plan_node_t> shape_plans;
 
+  /* Caches kept in the user data of the face by other parts of the
+   * library, such that hb_face_drop_caches() and hb_face_get_memory_usage()
+   * reach them; see _hb_face_add_cache(). */
+  struct cache_node_t
+  {
+    hb_user_data_key_t *key;
+    hb_tag_t subsystem;
+    unsigned int (*get_memory_usage) (void *data);
+    cache_node_t *next;
+  };
+  hb_atomic_ptr_t<cache_node_t> caches;
+
   inline hb_blob_t *reference_table (hb_tag_t tag) const
   {
     hb_blob_t *blob;
@@ -98,6 +155,11 @@ struct hb_face_t
 };
 DECLARE_NULL_INSTANCE (hb_face_t);
 
+HB_INTERNAL bool _hb_face_add_cache (hb_face_t *face,
+				     hb_user_data_key_t *key,
+				     hb_tag_t subsystem,
+				     unsigned int (*get_memory_usage) (void *data));
+
 #define HB_SHAPER_DATA_CREATE_FUNC_EXTRA_ARGS
 #define HB_SHAPER_IMPLEMENT(shaper) HB_SHAPER_DATA_PROTOTYPE(shaper, face);
 #include "hb-shaper-list.hh"
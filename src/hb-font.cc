@@ -1909,6 +1909,38 @@ hb_font_get_var_coords_normalized (hb_font_t *font,
   return font->coords;
 }
 
+/**
+ * hb_font_get_memory_usage:
+ * @font: a font.
+ * @usage_count: (inout) (optional): input length of @usage array, output
+ *               number of items written.
+ * @usage: (out) (array length=usage_count) (optional): array to write the
+ *         usage of each subsystem into.
+ *
+ * Reports the heap memory used by @font itself, per subsystem.  The face,
+ * parent font and font functions it references are not counted; see
+ * hb_face_get_memory_usage().
+ *
+ * Return value: total heap memory used by @font, in bytes, including
+ * subsystems that did not fit in @usage.
+ *
+ * Since: REPLACEME
+ **/
+unsigned int
+hb_font_get_memory_usage (hb_font_t         *font,
+			  unsigned int      *usage_count, /* IN/OUT */
+			  hb_memory_usage_t *usage /* OUT */)
+{
+  hb_memory_usage_accumulator_t c (usage_count, usage);
+  if (unlikely (hb_object_is_inert (font)))
+    return 0;
+
+  c.add (HB_MEMORY_USAGE_OBJECT, sizeof (*font) +
+				 font->num_coords * sizeof (font->coords[0]));
+
+  return c.total;
+}
+
 
 /*
  * Deprecated get_glyph_func():
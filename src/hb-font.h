@@ -674,6 +674,11 @@ HB_EXTERN const int *
 hb_font_get_var_coords_normalized (hb_font_t *font,
 				   unsigned int *length);
 
+HB_EXTERN unsigned int
+hb_font_get_memory_usage (hb_font_t         *font,
+			  unsigned int      *usage_count, /* IN/OUT */
+			  hb_memory_usage_t *usage /* OUT */);
+
 HB_END_DECLS
 
 #endif /* HB_FONT_H */
@@ -33,6 +33,7 @@
 #include "hb-blob.hh"
 
 #include "hb-iter.hh"
+#include "hb-map.hh"
 #include "hb-vector.hh"
 
 
@@ -118,7 +119,7 @@ static inline Type& StructAfter(TObject &X)
 
 #define DEFINE_SIZE_ARRAY_SIZED(size, array) \
 	DEFINE_SIZE_ARRAY(size, array); \
-	inline unsigned int get_size (void) const { return (size - array[0].min_size + array.get_size ()); }
+	inline unsigned int get_size (void) const { return (size - (array).min_size + (array).get_size ()); }
 
 #define DEFINE_SIZE_ARRAY2(size, array1, array2) \
   DEFINE_INSTANCE_ASSERTION (sizeof (*this) == (size) + sizeof (this->array1[0]) + sizeof (this->array2[0])); \
@@ -221,6 +222,12 @@ struct hb_dispatch_context_t
 #define HB_SANITIZE_MAX_OPS_MAX 0x3FFFFFFF
 #endif
 
+/* Trusted-tables mode; see hb_face_set_trusted_tables(). */
+HB_INTERNAL bool _hb_face_table_is_trusted (const hb_face_t *face, hb_tag_t tag, hb_blob_t *blob);
+HB_INTERNAL void _hb_face_table_sanitized (const hb_face_t *face, hb_tag_t tag, hb_blob_t *blob);
+HB_INTERNAL hb_blob_t *_hb_face_reference_sanitized_table (const hb_face_t *face, hb_tag_t tag);
+HB_INTERNAL bool _hb_face_keep_sanitized_tables (hb_face_t *face);
+
 struct hb_sanitize_context_t :
        hb_dispatch_context_t<hb_sanitize_context_t, bool, HB_DEBUG_SANITIZE>
 {
@@ -436,9 +443,22 @@ struct hb_sanitize_context_t :
   template <typename Type>
   inline hb_blob_t *reference_table (const hb_face_t *face, hb_tag_t tableTag = Type::tableTag)
   {
+    hb_blob_t *blob = _hb_face_reference_sanitized_table (face, tableTag);
+    if (unlikely (blob))
+      return blob;
+
+    blob = hb_face_reference_table (face, tableTag);
+    if (unlikely (_hb_face_table_is_trusted (face, tableTag, blob)))
+    {
+      hb_blob_make_immutable (blob);
+      return blob;
+    }
+
     if (!num_glyphs_set)
       set_num_glyphs (hb_face_get_glyph_count (face));
-    return sanitize_blob<Type> (hb_face_reference_table (face, tableTag));
+    blob = sanitize_blob<Type> (blob);
+    _hb_face_table_sanitized (face, tableTag, blob);
+    return blob;
   }
 
   mutable unsigned int debug_depth;
@@ -457,15 +477,72 @@ struct hb_sanitize_context_t :
  * Serialize
  */
 
+/* Reserved address space for growable serializers; see hb-static.cc. */
+HB_INTERNAL void *_hb_memory_reserve (unsigned int size);
+HB_INTERNAL bool _hb_memory_commit (void *p, unsigned int size);
+HB_INTERNAL void _hb_memory_release (void *p, unsigned int size);
+
+#ifndef HB_MEMORY_COMMIT_SIZE
+#define HB_MEMORY_COMMIT_SIZE 65536 /* A multiple of any page size. */
+#endif
+#ifndef HB_SERIALIZE_RESERVE_SIZE
+#define HB_SERIALIZE_RESERVE_SIZE (64u << 20)
+#endif
+
 struct hb_serialize_context_t
 {
   inline hb_serialize_context_t (void *start_, unsigned int size)
   {
     this->start = (char *) start_;
     this->end = this->start + size;
+    this->reserved = 0;
+    this->owned = false;
+    this->shared.init_shallow ();
+    this->shared_objects.init ();
+    reset ();
+  }
+
+  /* A growable context owns its buffer.  Where possible it reserves address
+   * space for at least @size bytes and commits more of it as serialization
+   * proceeds, so the buffer is extended in place and pointers handed out stay
+   * valid; otherwise it allocates @size bytes and can run out of room like a
+   * fixed one.  start is nullptr if allocation failed. */
+  inline hb_serialize_context_t (unsigned int size)
+  {
+    this->reserved = MAX (size, (unsigned int) HB_SERIALIZE_RESERVE_SIZE);
+    this->start = nullptr;
+    if (likely (this->reserved <= (unsigned int) -1 - HB_MEMORY_COMMIT_SIZE))
+    {
+      this->reserved += HB_MEMORY_COMMIT_SIZE - 1;
+      this->reserved -= this->reserved % HB_MEMORY_COMMIT_SIZE;
+      this->start = (char *) _hb_memory_reserve (this->reserved);
+    }
+    this->end = this->start;
+    if (!this->start)
+    {
+      this->reserved = 0;
+      this->start = this->end = (char *) malloc (size);
+      if (likely (this->start))
+	this->end += size;
+    }
+    this->owned = true;
+    this->shared.init_shallow ();
+    this->shared_objects.init ();
     reset ();
   }
 
+  inline ~hb_serialize_context_t (void)
+  {
+    this->shared.fini_shallow ();
+    this->shared_objects.fini ();
+    if (!this->owned)
+      return;
+    if (this->reserved)
+      _hb_memory_release (this->start, this->reserved);
+    else
+      free (this->start);
+  }
+
   inline void reset (void)
   {
     this->ran_out_of_room = false;
@@ -514,7 +591,8 @@ struct hb_serialize_context_t
   template <typename Type>
   inline Type *allocate_size (unsigned int size)
   {
-    if (unlikely (this->ran_out_of_room || this->end - this->head < ptrdiff_t (size))) {
+    if (unlikely (this->ran_out_of_room ||
+		  (this->end - this->head < ptrdiff_t (size) && !grow (size)))) {
       this->ran_out_of_room = true;
       return nullptr;
     }
@@ -524,6 +602,24 @@ struct hb_serialize_context_t
     return reinterpret_cast<Type *> (ret);
   }
 
+  /* Commits enough of the reservation for @size more bytes. */
+  inline bool grow (unsigned int size)
+  {
+    unsigned int committed = this->end - this->start;
+    unsigned int needed = this->head - this->start;
+    if (unlikely (needed + size < needed || needed + size > this->reserved))
+      return false;
+    needed += size;
+    needed = MAX (needed, committed + committed / 2);
+    needed += HB_MEMORY_COMMIT_SIZE - 1;
+    needed -= needed % HB_MEMORY_COMMIT_SIZE;
+    needed = MIN (needed, this->reserved);
+    if (unlikely (!_hb_memory_commit (this->start, needed)))
+      return false;
+    this->end = this->start + needed;
+    return true;
+  }
+
   template <typename Type>
   inline Type *allocate_min (void)
   {
@@ -558,6 +654,87 @@ struct hb_serialize_context_t
     return reinterpret_cast<Type *> (&obj);
   }
 
+  /* Object sharing.
+   *
+   * Objects are serialized depth-first, each followed by the objects it
+   * references, so an object and everything below it occupy [obj, head)
+   * and only hold offsets into that range.  An earlier object with the
+   * same bytes is then an equivalent copy, which the offset to this one can
+   * point to instead. */
+
+  /* To be called once the object at @obj, referenced by @offset from @base,
+   * is complete.  Drops it in favor of an identical object serialized
+   * before, if the offset can reach one; otherwise remembers it. */
+  template <typename OffsetType>
+  inline void share (OffsetType &offset, const void *base, char *obj)
+  {
+    if (unlikely (this->ran_out_of_room ||
+		  obj < (const char *) base || obj >= this->head))
+      return;
+
+    unsigned int len = this->head - obj;
+    uint32_t hash = 2166136261u; /* FNV-1a */
+    for (unsigned int i = 0; i < len; i++)
+      hash = (hash ^ (uint8_t) obj[i]) * 16777619u;
+    if (unlikely (hash == hb_map_t::INVALID))
+      hash--;
+
+    unsigned int obj_offset = obj - this->start;
+    unsigned int i = this->shared.get (hash);
+    if (i != hb_map_t::INVALID)
+    {
+      const shared_object_t &prev = this->shared_objects[i];
+      if (prev.length == len &&
+	  this->start + prev.offset >= (const char *) base &&
+	  prev.offset + len <= obj_offset &&
+	  0 == memcmp (this->start + prev.offset, obj, len))
+      {
+	unsigned int old_offset = offset;
+	unsigned int new_offset = this->start + prev.offset - (const char *) base;
+	offset.set (new_offset);
+	if ((unsigned int) offset == new_offset)
+	{
+	  revert (obj);
+	  return;
+	}
+	offset.set (old_offset);
+      }
+    }
+
+    /* Keep the latest; later objects are more likely to be in reach. */
+    shared_object_t *object = this->shared_objects.push ();
+    if (unlikely (this->shared_objects.in_error ()))
+      return;
+    object->hash = hash;
+    object->offset = obj_offset;
+    object->length = len;
+    object->prev = i;
+    this->shared.set (hash, this->shared_objects.len - 1);
+  }
+
+  /* Drops everything serialized from @obj on. */
+  inline void revert (char *obj)
+  {
+    if (unlikely (this->ran_out_of_room ||
+		  obj < this->start || obj > this->head))
+      return;
+    this->head = obj;
+
+    /* Objects are remembered as they complete, so the ones dropped are
+     * the latest. */
+    unsigned int obj_offset = obj - this->start;
+    while (this->shared_objects.len &&
+	   this->shared_objects[this->shared_objects.len - 1].offset >= obj_offset)
+    {
+      const shared_object_t &object = this->shared_objects[this->shared_objects.len - 1];
+      if (object.prev == hb_map_t::INVALID)
+	this->shared.del (object.hash);
+      else
+	this->shared.set (object.hash, object.prev);
+      this->shared_objects.pop ();
+    }
+  }
+
   /* Output routines. */
   template <typename Type>
   inline Type *copy (void) const
@@ -593,6 +770,21 @@ struct hb_serialize_context_t
   unsigned int debug_depth;
   char *start, *end, *head;
   bool ran_out_of_room;
+  private:
+  unsigned int reserved; /* Bytes of address space reserved at start, if any. */
+  bool owned;
+  struct shared_object_t
+  {
+    uint32_t hash;
+    unsigned int offset; /* From start. */
+    unsigned int length;
+    unsigned int prev; /* Index of the object with the same hash before. */
+  };
+  hb_map_t shared; /* Object hash to index into shared_objects. */
+  hb_vector_t<shared_object_t> shared_objects;
+
+  inline hb_serialize_context_t (const hb_serialize_context_t &); /* Disallow copy */
+  inline hb_serialize_context_t& operator= (const hb_serialize_context_t &); /* Disallow copy */
 };
 
 
@@ -717,6 +909,54 @@ struct BEInt<Type, 4>
 };
 
 
+/*
+ * Memory usage.
+ */
+
+/* Collects hb_memory_usage_t reports into the caller's IN/OUT array,
+ * merging reports for the same subsystem. */
+struct hb_memory_usage_accumulator_t
+{
+  inline hb_memory_usage_accumulator_t (unsigned int      *usage_count_,
+					hb_memory_usage_t *usage_) :
+					usage_count (usage_count_),
+					usage (usage_),
+					max_count (usage_count_ ? *usage_count_ : 0),
+					total (0)
+  {
+    if (usage_count)
+      *usage_count = 0;
+  }
+
+  inline void add (hb_tag_t subsystem, unsigned int bytes)
+  {
+    if (!bytes)
+      return;
+    total += bytes;
+
+    if (!usage_count)
+      return;
+    for (unsigned int i = 0; i < *usage_count; i++)
+      if (usage[i].subsystem == subsystem)
+      {
+	usage[i].bytes += bytes;
+	return;
+      }
+    if (*usage_count < max_count)
+    {
+      usage[*usage_count].subsystem = subsystem;
+      usage[*usage_count].bytes = bytes;
+      (*usage_count)++;
+    }
+  }
+
+  unsigned int *usage_count;
+  hb_memory_usage_t *usage;
+  unsigned int max_count;
+  unsigned int total;
+};
+
+
 /*
  * Lazy loaders.
  */
@@ -166,10 +166,15 @@ struct hb_map_t
 
   inline void clear (void)
   {
-    memset (items, 0xFF, ((size_t) mask + 1) * sizeof (item_t));
+    if (items)
+      memset (items, 0xFF, ((size_t) mask + 1) * sizeof (item_t));
     population = occupancy = 0;
   }
 
+  /* Heap memory used, not counting the map itself. */
+  inline unsigned int get_memory_usage (void) const
+  { return items ? (mask + 1) * sizeof (item_t) : 0; }
+
   inline bool is_empty (void) const
   {
     return population != 0;
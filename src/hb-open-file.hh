@@ -197,6 +197,67 @@ typedef struct OffsetTable
     return_trace (true);
   }
 
+  /* Like serialize(), but only writes the table directory.  The tables
+   * are to follow it in the order given, each padded to four bytes.  As
+   * the head table is not copied, its checkSumAdjustment is returned in
+   * *checksum_adjustment instead; zero if there is no head table. */
+  inline bool serialize_directory (hb_serialize_context_t *c,
+				   hb_tag_t sfnt_tag,
+				   Supplier<hb_tag_t> &tags,
+				   Supplier<hb_blob_t *> &blobs,
+				   unsigned int table_count,
+				   uint32_t *checksum_adjustment)
+  {
+    TRACE_SERIALIZE (this);
+    if (unlikely (!c->extend_min (*this))) return_trace (false);
+    sfnt_version.set (sfnt_tag);
+    if (unlikely (!tables.serialize (c, table_count))) return_trace (false);
+
+    const char *dir_end = (const char *) c->head;
+    unsigned int offset = dir_end - (const char *) this;
+    bool has_head = false;
+
+    for (unsigned int i = 0; i < table_count; i++)
+    {
+      TableRecord &rec = tables.arrayZ[i];
+      unsigned int length;
+      const char *data = hb_blob_get_data (blobs[i], &length);
+      rec.tag.set (tags[i]);
+      rec.length.set (length);
+      rec.offset.set (offset);
+
+      uint32_t sum = CheckSum::CalcUnalignedTableChecksum (data, length);
+      if (tags[i] == HB_OT_TAG_head && length >= head::static_size)
+      {
+	/* Checksummed with checkSumAdjustment set to zero. */
+	const head *h = (const head *) data;
+	sum -= CheckSum::CalcUnalignedTableChecksum ((const char *) &h->checkSumAdjustment, 4);
+	has_head = true;
+      }
+      rec.checkSum.set (sum);
+
+      unsigned int padded_length = hb_ceil_to_4 (length);
+      if (unlikely (offset + padded_length < offset)) return_trace (false);
+      offset += padded_length;
+    }
+    tags += table_count;
+    blobs += table_count;
+
+    tables.qsort ();
+
+    *checksum_adjustment = 0;
+    if (has_head)
+    {
+      CheckSum checksum;
+      checksum.set_for_data (this, dir_end - (const char *) this);
+      for (unsigned int i = 0; i < table_count; i++)
+	checksum.set (checksum + tables.arrayZ[i].checkSum);
+      *checksum_adjustment = 0xB1B0AFBAu - checksum;
+    }
+
+    return_trace (true);
+  }
+
   inline bool sanitize (hb_sanitize_context_t *c) const
   {
     TRACE_SANITIZE (this);
@@ -507,6 +568,20 @@ struct OpenTypeFontFile
     return_trace (u.fontFace.serialize (c, sfnt_tag, tags, blobs, table_count));
   }
 
+  inline bool serialize_single_directory (hb_serialize_context_t *c,
+					  hb_tag_t sfnt_tag,
+					  Supplier<hb_tag_t> &tags,
+					  Supplier<hb_blob_t *> &blobs,
+					  unsigned int table_count,
+					  uint32_t *checksum_adjustment)
+  {
+    TRACE_SERIALIZE (this);
+    assert (sfnt_tag != TTCTag);
+    if (unlikely (!c->extend_min (*this))) return_trace (false);
+    return_trace (u.fontFace.serialize_directory (c, sfnt_tag, tags, blobs, table_count,
+						  checksum_adjustment));
+  }
+
   inline bool sanitize (hb_sanitize_context_t *c) const
   {
     TRACE_SANITIZE (this);
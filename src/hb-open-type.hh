@@ -193,6 +193,20 @@ struct CheckSum : HBUINT32
     return Sum;
   }
 
+  /* Same as above, but for data of any alignment and length.  Sums the
+   * data as if it was zero-padded to a multiple of four bytes. */
+  static inline uint32_t CalcUnalignedTableChecksum (const char *data, unsigned int length)
+  {
+    const uint8_t *p = (const uint8_t *) data;
+    uint32_t Sum = 0L;
+    unsigned int i;
+    for (i = 0; i + 4 <= length; i += 4)
+      Sum += ((uint32_t) p[i] << 24) | (p[i + 1] << 16) | (p[i + 2] << 8) | p[i + 3];
+    for (; i < length; i++)
+      Sum += (uint32_t) p[i] << (24 - 8 * (i & 3));
+    return Sum;
+  }
+
   /* Note: data should be 4byte aligned and have 4byte padding at the end. */
   inline void set_for_data (const void *data, unsigned int length)
   { set (CalcTableChecksum ((const HBUINT32 *) data, length)); }
@@ -261,9 +275,14 @@ struct OffsetTo : Offset<OffsetType, has_null>
       this->set (0);
       return;
     }
-    serialize (c->serializer, base);
+    char *obj = (char *) &serialize (c->serializer, base);
     if (!src.subset (c))
+    {
       this->set (0);
+      c->serializer->revert (obj);
+      return;
+    }
+    c->serializer->share (*this, base, obj);
   }
 
   inline bool sanitize_shallow (hb_sanitize_context_t *c, const void *base) const
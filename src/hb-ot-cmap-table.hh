@@ -1071,6 +1071,8 @@ struct cmap
       hb_blob_destroy (this->blob);
     }
 
+    inline unsigned int get_memory_usage (void) const { return 0; } /* Only holds blobs. */
+
     inline bool get_nominal_glyph (hb_codepoint_t  unicode,
 				   hb_codepoint_t *glyph) const
     {
@@ -408,6 +408,8 @@ struct CBDT
       hb_blob_destroy (this->cbdt_blob);
     }
 
+    inline unsigned int get_memory_usage (void) const { return 0; } /* Only holds blobs. */
+
     inline bool get_extents (hb_codepoint_t glyph, hb_glyph_extents_t *extents) const
     {
       unsigned int x_ppem = upem, y_ppem = upem; /* TODO Use font ppem if available. */
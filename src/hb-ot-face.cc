@@ -55,6 +55,31 @@ void hb_ot_face_data_t::fini (void)
 #undef HB_OT_TABLE
 }
 
+void hb_ot_face_data_t::add_memory_usage (hb_memory_usage_accumulator_t *usage) const
+{
+  /* Table blobs normally point into the font data, so only count the
+   * accelerators. */
+  usage->add (HB_MEMORY_USAGE_OBJECT, sizeof (*this));
+#define HB_OT_TABLE(Namespace, Type)
+#define HB_OT_ACCELERATOR(Namespace, Type) \
+  { \
+    const Namespace::Type##_accelerator_t *p = Type.get_stored_relaxed (); \
+    if (p && p != Type.get_null ()) \
+      usage->add (Namespace::Type::tableTag, sizeof (*p) + p->get_memory_usage ()); \
+  }
+  HB_OT_TABLES
+#undef HB_OT_ACCELERATOR
+#undef HB_OT_TABLE
+}
+void hb_ot_face_data_t::free_instances (void)
+{
+#define HB_OT_TABLE(Namespace, Type) Type.free_instance ();
+#define HB_OT_ACCELERATOR(Namespace, Type) HB_OT_TABLE (Namespace, Type)
+  HB_OT_TABLES
+#undef HB_OT_ACCELERATOR
+#undef HB_OT_TABLE
+}
+
 hb_ot_face_data_t *
 _hb_ot_face_data_create (hb_face_t *face)
 {
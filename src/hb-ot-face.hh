@@ -83,6 +83,10 @@ struct hb_ot_face_data_t
   HB_INTERNAL void init0 (hb_face_t *face);
   HB_INTERNAL void fini (void);
 
+  /* Accelerator and table memory, dropping it. */
+  HB_INTERNAL void add_memory_usage (hb_memory_usage_accumulator_t *usage) const;
+  HB_INTERNAL void free_instances (void);
+
 #define HB_OT_TABLE_ORDER(Namespace, Type) \
     HB_PASTE (ORDER_, HB_PASTE (Namespace, HB_PASTE (_, Type)))
   enum order_t
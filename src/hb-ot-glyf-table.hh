@@ -260,6 +260,8 @@ struct glyf
       hb_blob_destroy (glyf_blob);
     }
 
+    inline unsigned int get_memory_usage (void) const { return 0; } /* Only holds blobs. */
+
     /*
      * Returns true if the referenced glyph is a valid glyph and a composite glyph.
      * If true is returned a pointer to the composite glyph will be written into
@@ -281,11 +283,13 @@ struct glyf
     }
 
     enum simple_glyph_flag_t {
+      FLAG_ON_CURVE = 0x01,
       FLAG_X_SHORT = 0x02,
       FLAG_Y_SHORT = 0x04,
       FLAG_REPEAT = 0x08,
       FLAG_X_SAME = 0x10,
-      FLAG_Y_SAME = 0x20
+      FLAG_Y_SAME = 0x20,
+      FLAG_OVERLAP_SIMPLE = 0x40
     };
 
     /* based on FontTools _g_l_y_f.py::trim */
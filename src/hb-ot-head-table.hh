@@ -54,6 +54,13 @@ struct head
     return 16 <= upem && upem <= 16384 ? upem : 1000;
   }
 
+  inline void set_checksum_adjustment (uint32_t value)
+  { checkSumAdjustment.set (value); }
+
+  /* Sets bit 11 of flags, for fonts whose data was transformed. */
+  inline void set_lossless (void)
+  { flags.set (flags | (1u << 11)); }
+
   inline bool sanitize (hb_sanitize_context_t *c) const
   {
     TRACE_SANITIZE (this);
@@ -249,6 +249,8 @@ struct hmtxvmtx
       hb_blob_destroy (var_blob);
     }
 
+    inline unsigned int get_memory_usage (void) const { return 0; } /* Only holds blobs. */
+
     inline unsigned int get_advance (hb_codepoint_t glyph) const
     {
       if (unlikely (glyph >= num_metrics))
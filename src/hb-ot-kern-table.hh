@@ -28,6 +28,7 @@
 #define HB_OT_KERN_TABLE_HH
 
 #include "hb-open-type.hh"
+#include "hb-map.hh"
 #include "hb-ot-shape.hh"
 #include "hb-ot-layout-gsubgpos.hh"
 
@@ -122,6 +123,49 @@ struct hb_glyph_pair_t
   hb_codepoint_t right;
 };
 
+/* Native-endian hash of (left, right) glyph pairs to kerning values,
+ * built once per face so that kerning a pair does not binary-search
+ * every subtable. */
+struct hb_kern_pair_map_t
+{
+  inline void init (void) { map.init (); last_pair = 0; }
+  inline void fini (void) { map.fini (); }
+  inline void clear (void) { map.clear (); last_pair = 0; }
+  inline bool in_error (void) const { return !map.successful; }
+  inline unsigned int get_memory_usage (void) const { return map.get_memory_usage (); }
+
+  inline void add (hb_codepoint_t left, hb_codepoint_t right, int value)
+  {
+    hb_codepoint_t key = left << 16 | right;
+    if (unlikely (key == HB_MAP_VALUE_INVALID))
+    {
+      last_pair += value;
+      return;
+    }
+    map.set (key, encode (decode (map.get (key)) + value));
+  }
+
+  inline int get (hb_codepoint_t left, hb_codepoint_t right) const
+  {
+    if (unlikely ((left | right) > 0xFFFFu)) return 0;
+    hb_codepoint_t key = left << 16 | right;
+    if (unlikely (key == HB_MAP_VALUE_INVALID)) return last_pair;
+    return decode (map.get (key));
+  }
+
+  private:
+  /* Values are stored complemented, such that a missing key,
+   * HB_MAP_VALUE_INVALID, reads back as zero kerning, and setting
+   * a pair to zero removes it. */
+  static inline hb_codepoint_t encode (int v) { return ~(hb_codepoint_t) v; }
+  static inline int decode (hb_codepoint_t v) { return (int) ~v; }
+
+  hb_map_t map;
+  /* The pair (0xFFFF, 0xFFFF), whose key is HB_MAP_VALUE_INVALID and
+   * cannot be stored in the map. */
+  int last_pair;
+};
+
 struct KernPair
 {
   inline int get_kerning (void) const
@@ -140,9 +184,10 @@ struct KernPair
     return_trace (c->check_struct (this));
   }
 
-  protected:
+  public:
   GlyphID	left;
   GlyphID	right;
+  protected:
   FWORD		value;
   public:
   DEFINE_SIZE_STATIC (6);
@@ -159,6 +204,18 @@ struct KernSubTableFormat0
     return pairs[i].get_kerning ();
   }
 
+  inline void add_kerning (hb_kern_pair_map_t *map) const
+  {
+    unsigned int count = pairs.len;
+    for (unsigned int i = 0; i < count; i++)
+    {
+      /* Duplicate pairs are adjacent; only one of them is ever found. */
+      if (i && pairs[i].left == pairs[i - 1].left && pairs[i].right == pairs[i - 1].right)
+        continue;
+      map->add (pairs[i].left, pairs[i].right, pairs[i].get_kerning ());
+    }
+  }
+
   inline bool sanitize (hb_sanitize_context_t *c) const
   {
     TRACE_SANITIZE (this);
@@ -244,6 +301,15 @@ struct KernSubTable
     }
   }
 
+  inline void add_kerning (hb_kern_pair_map_t *map, unsigned int format) const
+  {
+    switch (format) {
+    case 0: u.format0.add_kerning (map); return;
+    /* Format 2 is disabled; see KernSubTableFormat2::get_kerning(). */
+    default:return;
+    }
+  }
+
   inline bool sanitize (hb_sanitize_context_t *c, unsigned int format) const
   {
     TRACE_SANITIZE (this);
@@ -282,6 +348,9 @@ struct KernSubTableWrapper
   inline int get_h_kerning (hb_codepoint_t left, hb_codepoint_t right, const char *end) const
   { return is_horizontal () ? get_kerning (left, right, end) : 0; }
 
+  inline void add_h_kerning (hb_kern_pair_map_t *map) const
+  { if (is_horizontal ()) thiz()->subtable.add_kerning (map, thiz()->format); }
+
   inline unsigned int get_size (void) const { return thiz()->length; }
 
   inline bool sanitize (hb_sanitize_context_t *c) const
@@ -315,6 +384,21 @@ struct KernTable
     return v;
   }
 
+  /* Same as summing get_h_kerning() over all pairs: an override subtable
+   * discards whatever the subtables before it contributed. */
+  inline void add_h_kerning (hb_kern_pair_map_t *map) const
+  {
+    const typename T::SubTableWrapper *st = CastP<typename T::SubTableWrapper> (&thiz()->dataZ);
+    unsigned int count = thiz()->nTables;
+    for (unsigned int i = 0; i < count; i++)
+    {
+      if (st->is_override ())
+        map->clear ();
+      st->add_h_kerning (map);
+      st = &StructAfter<typename T::SubTableWrapper> (*st);
+    }
+  }
+
   inline bool sanitize (hb_sanitize_context_t *c) const
   {
     TRACE_SANITIZE (this);
@@ -435,6 +519,15 @@ struct kern
     }
   }
 
+  inline void add_h_kerning (hb_kern_pair_map_t *map) const
+  {
+    switch (u.major) {
+    case 0: u.ot.add_h_kerning (map); return;
+    case 1: u.aat.add_h_kerning (map); return;
+    default:return;
+    }
+  }
+
   inline bool sanitize (hb_sanitize_context_t *c) const
   {
     TRACE_SANITIZE (this);
@@ -452,17 +545,36 @@ struct kern
     {
       blob = hb_sanitize_context_t().reference_table<kern> (face);
       table = blob->as<kern> ();
+
+      pairs.init ();
+      table->add_h_kerning (&pairs);
+      if (unlikely (pairs.in_error ()))
+      {
+        pairs.fini ();
+        pairs.init ();
+        pairs_usable = false;
+      }
+      else
+        pairs_usable = true;
     }
     inline void fini (void)
     {
+      pairs.fini ();
       hb_blob_destroy (blob);
     }
 
     inline bool has_data (void) const
     { return table->has_data (); }
 
+    inline unsigned int get_memory_usage (void) const
+    { return pairs.get_memory_usage (); }
+
     inline int get_h_kerning (hb_codepoint_t left, hb_codepoint_t right) const
-    { return table->get_h_kerning (left, right); }
+    {
+      if (likely (pairs_usable))
+        return pairs.get (left, right);
+      return table->get_h_kerning (left, right);
+    }
 
     inline int get_kerning (hb_codepoint_t first, hb_codepoint_t second) const
     { return get_h_kerning (first, second); }
@@ -483,6 +595,9 @@ struct kern
     private:
     hb_blob_t *blob;
     const kern *table;
+    hb_kern_pair_map_t pairs;	/* Horizontal kerning of all subtables,
+				 * summed, in font units. */
+    bool pairs_usable;
   };
 
   protected:
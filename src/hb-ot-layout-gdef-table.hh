@@ -287,6 +287,13 @@ struct MarkGlyphSetsFormat1
   inline bool covers (unsigned int set_index, hb_codepoint_t glyph_id) const
   { return (this+coverage[set_index]).get_coverage (glyph_id) != NOT_COVERED; }
 
+  inline unsigned int get_set_count (void) const
+  { return coverage.len; }
+
+  template <typename set_t>
+  inline bool add_coverage (unsigned int set_index, set_t *glyphs) const
+  { return (this+coverage[set_index]).add_coverage (glyphs); }
+
   inline bool sanitize (hb_sanitize_context_t *c) const
   {
     TRACE_SANITIZE (this);
@@ -312,6 +319,23 @@ struct MarkGlyphSets
     }
   }
 
+  inline unsigned int get_set_count (void) const
+  {
+    switch (u.format) {
+    case 1: return u.format1.get_set_count ();
+    default:return 0;
+    }
+  }
+
+  template <typename set_t>
+  inline bool add_coverage (unsigned int set_index, set_t *glyphs) const
+  {
+    switch (u.format) {
+    case 1: return u.format1.add_coverage (set_index, glyphs);
+    default:return false;
+    }
+  }
+
   inline bool sanitize (hb_sanitize_context_t *c) const
   {
     TRACE_SANITIZE (this);
@@ -382,6 +406,8 @@ struct GDEF
   inline bool has_mark_sets (void) const { return version.to_int () >= 0x00010002u && markGlyphSetsDef != 0; }
   inline bool mark_set_covers (unsigned int set_index, hb_codepoint_t glyph_id) const
   { return version.to_int () >= 0x00010002u && (this+markGlyphSetsDef).covers (set_index, glyph_id); }
+  inline const MarkGlyphSets &get_mark_glyph_sets (void) const
+  { return version.to_int () >= 0x00010002u ? this+markGlyphSetsDef : Null(MarkGlyphSets); }
 
   inline bool has_var_store (void) const { return version.to_int () >= 0x00010003u && varStore != 0; }
   inline const VariationStore &get_var_store (void) const
@@ -410,15 +436,71 @@ struct GDEF
 
   struct accelerator_t
   {
+    /* Number of mark glyph sets whose membership is flattened into
+     * mark_sets; lookups using higher set indices query the table. */
+    enum { MAX_FLATTENED_MARK_SETS = 16 };
+
     HB_INTERNAL inline void init (hb_face_t *face);
 
     inline void fini (void)
     {
+      glyph_props.fini ();
+      mark_sets.fini ();
       hb_blob_destroy (this->blob);
     }
 
+    inline unsigned int get_memory_usage (void) const
+    { return glyph_props.get_memory_usage () + mark_sets.get_memory_usage (); }
+
+    inline unsigned int get_glyph_props (hb_codepoint_t glyph) const
+    {
+      if (likely (glyph < glyph_props.len))
+	return glyph_props.arrayZ()[glyph];
+      return get_table ().get_glyph_props (glyph);
+    }
+
+    inline bool mark_set_covers (unsigned int set_index, hb_codepoint_t glyph) const
+    {
+      if (likely (set_index < MAX_FLATTENED_MARK_SETS && glyph < mark_sets.len))
+	return mark_sets.arrayZ()[glyph] & (1u << set_index);
+      return get_table ().mark_set_covers (set_index, glyph);
+    }
+
+    /* The Null accelerator, handed out when face data could not be
+     * created, has no table. */
+    inline const GDEF &get_table (void) const
+    { return likely (table) ? *table : Null(GDEF); }
+
+    inline void flatten (unsigned int num_glyphs)
+    {
+      if (table->has_glyph_classes () && glyph_props.resize (num_glyphs))
+      {
+	uint16_t *props = glyph_props.arrayZ();
+	for (unsigned int i = 0; i < num_glyphs; i++)
+	  props[i] = table->get_glyph_props (i);
+      }
+
+      const MarkGlyphSets &sets = table->get_mark_glyph_sets ();
+      unsigned int set_count = MIN (sets.get_set_count (), (unsigned int) MAX_FLATTENED_MARK_SETS);
+      if (set_count && mark_sets.resize (num_glyphs))
+      {
+	uint16_t *bits = mark_sets.arrayZ();
+	hb_auto_t<hb_set_t> glyphs;
+	for (unsigned int i = 0; i < set_count; i++)
+	{
+	  glyphs.clear ();
+	  sets.add_coverage (i, &glyphs);
+	  for (hb_codepoint_t g = HB_SET_VALUE_INVALID; glyphs.next (&g) && g < num_glyphs;)
+	    bits[g] |= 1u << i;
+	}
+      }
+    }
+
     hb_blob_t *blob;
     const GDEF *table;
+    hb_vector_t<uint16_t> glyph_props;	/* GDEF glyph_props, indexed by glyph id. */
+    hb_vector_t<uint16_t> mark_sets;	/* Mark glyph set membership bits, indexed
+					 * by glyph id. */
   };
 
   inline unsigned int get_size (void) const
@@ -46,6 +46,9 @@ enum attach_type_t {
   /* Each attachment should be either a mark or a cursive; can't be both. */
   ATTACH_TYPE_MARK	= 0X01,
   ATTACH_TYPE_CURSIVE	= 0X02,
+
+  /* Set while propagate_attachment_offsets() has the glyph on its path. */
+  ATTACH_TYPE_PENDING	= 0X80,
 };
 
 
@@ -432,7 +435,7 @@ struct MarkArray : ArrayOf<MarkRecord>	/* Array of MarkRecords--in Coverage orde
 
     float mark_x, mark_y, base_x, base_y;
 
-    buffer->unsafe_to_break (glyph_pos, buffer->idx);
+    c->unsafe_to_break_to_cur (glyph_pos);
     mark_anchor.get_anchor (c, buffer->cur().codepoint, &mark_x, &mark_y);
     glyph_anchor.get_anchor (c, buffer->info[glyph_pos].codepoint, &base_x, &base_y);
 
@@ -1146,25 +1149,41 @@ struct MarkBasePosFormat1
     hb_ot_apply_context_t::skipping_iterator_t &skippy_iter = c->iter_input;
     skippy_iter.reset (buffer->idx, 1);
     skippy_iter.set_lookup_props (LookupFlag::IgnoreMarks);
-    do {
-      if (!skippy_iter.prev ()) return_trace (false);
-      /* We only want to attach to the first of a MultipleSubst sequence.
-       * https://github.com/harfbuzz/harfbuzz/issues/740
-       * Reject others...
-       * ...but stop if we find a mark in the MultipleSubst sequence:
-       * https://github.com/harfbuzz/harfbuzz/issues/1020 */
-      if (!_hb_glyph_info_multiplied (&buffer->info[skippy_iter.idx]) ||
-	  0 == _hb_glyph_info_get_lig_comp (&buffer->info[skippy_iter.idx]) ||
-	  (skippy_iter.idx == 0 ||
-	   _hb_glyph_info_is_mark (&buffer->info[skippy_iter.idx - 1]) ||
-	   _hb_glyph_info_get_lig_id (&buffer->info[skippy_iter.idx]) !=
-	   _hb_glyph_info_get_lig_id (&buffer->info[skippy_iter.idx - 1]) ||
-	   _hb_glyph_info_get_lig_comp (&buffer->info[skippy_iter.idx]) !=
-	   _hb_glyph_info_get_lig_comp (&buffer->info[skippy_iter.idx - 1]) + 1
-	   ))
-	break;
-      skippy_iter.reject ();
-    } while (1);
+    unsigned int base_pos;
+    if (c->get_base_memo (hb_ot_apply_context_t::base_memo_t::MARK_BASE, &base_pos))
+    {
+      if (base_pos == (unsigned int) -1) return_trace (false);
+      skippy_iter.idx = base_pos;
+    }
+    else
+    {
+      do {
+	if (!skippy_iter.prev ())
+	{
+	  c->set_base_memo (hb_ot_apply_context_t::base_memo_t::MARK_BASE, (unsigned int) -1);
+	  return_trace (false);
+	}
+	/* We only want to attach to the first of a MultipleSubst sequence.
+	 * https://github.com/harfbuzz/harfbuzz/issues/740
+	 * Reject others...
+	 * ...but stop if we find a mark in the MultipleSubst sequence:
+	 * https://github.com/harfbuzz/harfbuzz/issues/1020 */
+	if (!_hb_glyph_info_multiplied (&buffer->info[skippy_iter.idx]) ||
+	    0 == _hb_glyph_info_get_lig_comp (&buffer->info[skippy_iter.idx]) ||
+	    (skippy_iter.idx == 0 ||
+	     _hb_glyph_info_is_mark (&buffer->info[skippy_iter.idx - 1]) ||
+	     _hb_glyph_info_get_lig_id (&buffer->info[skippy_iter.idx]) !=
+	     _hb_glyph_info_get_lig_id (&buffer->info[skippy_iter.idx - 1]) ||
+	     _hb_glyph_info_get_lig_comp (&buffer->info[skippy_iter.idx]) !=
+	     _hb_glyph_info_get_lig_comp (&buffer->info[skippy_iter.idx - 1]) + 1
+	     ))
+	{
+	  c->set_base_memo (hb_ot_apply_context_t::base_memo_t::MARK_BASE, skippy_iter.idx);
+	  break;
+	}
+	skippy_iter.reject ();
+      } while (1);
+    }
 
     /* Checking that matched glyph is actually a base glyph by GDEF is too strong; disabled */
     //if (!_hb_glyph_info_is_base_glyph (&buffer->info[skippy_iter.idx])) { return_trace (false); }
@@ -1269,7 +1288,15 @@ struct MarkLigPosFormat1
     hb_ot_apply_context_t::skipping_iterator_t &skippy_iter = c->iter_input;
     skippy_iter.reset (buffer->idx, 1);
     skippy_iter.set_lookup_props (LookupFlag::IgnoreMarks);
-    if (!skippy_iter.prev ()) return_trace (false);
+    unsigned int lig_pos;
+    if (c->get_base_memo (hb_ot_apply_context_t::base_memo_t::MARK_LIG, &lig_pos))
+      skippy_iter.idx = lig_pos;
+    else
+    {
+      lig_pos = skippy_iter.prev () ? skippy_iter.idx : (unsigned int) -1;
+      c->set_base_memo (hb_ot_apply_context_t::base_memo_t::MARK_LIG, lig_pos);
+    }
+    if (lig_pos == (unsigned int) -1) return_trace (false);
 
     /* Checking that matched glyph is actually a ligature by GDEF is too strong; disabled */
     //if (!_hb_glyph_info_is_ligature (&buffer->info[skippy_iter.idx])) { return_trace (false); }
@@ -1657,21 +1684,10 @@ reverse_cursive_minor_offset (hb_glyph_position_t *pos, unsigned int i, hb_direc
   pos[j].attach_chain() = -chain;
   pos[j].attach_type() = type;
 }
-static void
-propagate_attachment_offsets (hb_glyph_position_t *pos, unsigned int i, hb_direction_t direction)
+static inline void
+apply_attachment_offset (hb_glyph_position_t *pos, unsigned int i, unsigned int j,
+			 int type, hb_direction_t direction, const int *advance_sums)
 {
-  /* Adjusts offsets of attached glyphs (both cursive and mark) to accumulate
-   * offset of glyph they are attached to. */
-  int chain = pos[i].attach_chain(), type = pos[i].attach_type();
-  if (likely (!chain))
-    return;
-
-  unsigned int j = (int) i + chain;
-
-  pos[i].attach_chain() = 0;
-
-  propagate_attachment_offsets (pos, j, direction);
-
   assert (!!(type & ATTACH_TYPE_MARK) ^ !!(type & ATTACH_TYPE_CURSIVE));
 
   if (type & ATTACH_TYPE_CURSIVE)
@@ -1687,7 +1703,25 @@ propagate_attachment_offsets (hb_glyph_position_t *pos, unsigned int i, hb_direc
     pos[i].y_offset += pos[j].y_offset;
 
     assert (j < i);
-    if (HB_DIRECTION_IS_FORWARD (direction))
+    if (advance_sums)
+    {
+      /* Advances of glyphs j..i-1, or of j+1..i backward. */
+      unsigned int from = HB_DIRECTION_IS_FORWARD (direction) ? j : j + 1;
+      unsigned int to = HB_DIRECTION_IS_FORWARD (direction) ? i : i + 1;
+      int x = advance_sums[2 * to] - advance_sums[2 * from];
+      int y = advance_sums[2 * to + 1] - advance_sums[2 * from + 1];
+      if (HB_DIRECTION_IS_FORWARD (direction))
+      {
+	pos[i].x_offset -= x;
+	pos[i].y_offset -= y;
+      }
+      else
+      {
+	pos[i].x_offset += x;
+	pos[i].y_offset += y;
+      }
+    }
+    else if (HB_DIRECTION_IS_FORWARD (direction))
       for (unsigned int k = j; k < i; k++) {
 	pos[i].x_offset -= pos[k].x_advance;
 	pos[i].y_offset -= pos[k].y_advance;
@@ -1699,6 +1733,45 @@ propagate_attachment_offsets (hb_glyph_position_t *pos, unsigned int i, hb_direc
       }
   }
 }
+static void
+propagate_attachment_offsets (hb_glyph_position_t *pos, unsigned int i, hb_direction_t direction,
+			      const int *advance_sums)
+{
+  /* Adjusts offsets of attached glyphs (both cursive and mark) to accumulate
+   * offset of glyph they are attached to. */
+  if (likely (!pos[i].attach_chain()))
+    return;
+
+  /* Walk up the chain to the first glyph that is resolved already, or is
+   * on the path itself if the chain loops.  The link of each glyph passed
+   * is replaced by one back to the glyph we came from, so that the path
+   * can be walked back down without recursing or allocating. */
+  unsigned int prev = i;
+  unsigned int cur = i;
+  while (pos[cur].attach_chain() && !(pos[cur].attach_type() & ATTACH_TYPE_PENDING))
+  {
+    unsigned int next = (int) cur + pos[cur].attach_chain();
+    pos[cur].attach_chain() = (int) prev - (int) cur;
+    pos[cur].attach_type() |= ATTACH_TYPE_PENDING;
+    prev = cur;
+    cur = next;
+  }
+
+  /* Walk back down, resolving each glyph against its parent. */
+  unsigned int j = cur;
+  cur = prev;
+  while (true)
+  {
+    int back = pos[cur].attach_chain();
+    pos[cur].attach_chain() = 0;
+    pos[cur].attach_type() &= ~ATTACH_TYPE_PENDING;
+    apply_attachment_offset (pos, cur, j, pos[cur].attach_type(), direction, advance_sums);
+    if (cur == i)
+      break;
+    j = cur;
+    cur = (int) cur + back;
+  }
+}
 
 void
 GPOS::position_start (hb_font_t *font HB_UNUSED, hb_buffer_t *buffer)
@@ -1725,8 +1798,28 @@ GPOS::position_finish_offsets (hb_font_t *font HB_UNUSED, hb_buffer_t *buffer)
 
   /* Handle attachments */
   if (buffer->scratch_flags & HB_BUFFER_SCRATCH_FLAG_HAS_GPOS_ATTACHMENT)
+  {
+    /* A mark is offset by the advances between it and its base; with
+     * running sums of them, a long stack of marks on one base is linear.
+     * Short buffers, or failing to allocate, sum as they go. */
+    int *advance_sums = nullptr;
+    if (len > 32 && len < (unsigned int) -1 / (2 * sizeof (int)) - 1)
+      advance_sums = (int *) malloc (2 * (len + 1) * sizeof (int));
+    if (advance_sums)
+    {
+      advance_sums[0] = advance_sums[1] = 0;
+      for (unsigned int i = 0; i < len; i++)
+      {
+	advance_sums[2 * i + 2] = advance_sums[2 * i] + pos[i].x_advance;
+	advance_sums[2 * i + 3] = advance_sums[2 * i + 1] + pos[i].y_advance;
+      }
+    }
+
     for (unsigned int i = 0; i < len; i++)
-      propagate_attachment_offsets (pos, i, direction);
+      propagate_attachment_offsets (pos, i, direction, advance_sums);
+
+    free (advance_sums);
+  }
 }
 
 
@@ -1746,7 +1839,10 @@ template <typename context_t>
   unsigned int saved_lookup_index = c->lookup_index;
   c->set_lookup_index (lookup_index);
   c->set_lookup_props (l.get_props ());
+  HB_BUFFER_COUNT (c->counters, visits, 1);
   bool ret = l.dispatch (c);
+  if (ret)
+    HB_BUFFER_COUNT (c->counters, applies, 1);
   c->set_lookup_index (saved_lookup_index);
   c->set_lookup_props (saved_lookup_props);
   return ret;
@@ -348,6 +348,7 @@ struct Sequence
     else if (unlikely (count == 0))
     {
       c->buffer->delete_glyph ();
+      HB_BUFFER_COUNT (c->counters, glyphs_removed, 1);
       return_trace (true);
     }
 
@@ -359,6 +360,7 @@ struct Sequence
       c->output_glyph_for_component (substitute.arrayZ[i], klass);
     }
     c->buffer->skip_glyph ();
+    HB_BUFFER_COUNT (c->counters, glyphs_removed, 1);
 
     return_trace (true);
   }
@@ -747,6 +749,11 @@ struct Ligature
     return_trace (true);
   }
 
+  /* Cheap pre-check before apply(): false if the second component rules
+   * this ligature out, given the glyph match_input() would compare it to. */
+  inline bool may_match_second (hb_codepoint_t glyph) const
+  { return component.lenP1 <= 1 || component[1] == glyph; }
+
   inline bool apply (hb_ot_apply_context_t *c) const
   {
     TRACE_APPLY (this);
@@ -859,9 +866,29 @@ struct LigatureSet
   {
     TRACE_APPLY (this);
     unsigned int num_ligs = ligature.len;
+
+    /* For large sets, find the glyph that the second component of every
+     * ligature will be matched against once, and only run the full
+     * match_input() for ligatures whose second component is that glyph.
+     * If that glyph is one the matcher may or may not skip (eg. a
+     * default-ignorable), which glyph gets compared depends on the
+     * ligature, so fall back to trying them all. */
+    hb_codepoint_t second = HB_SET_VALUE_INVALID;
+    if (num_ligs > 4)
+    {
+      hb_ot_apply_context_t::skipping_iterator_t &skippy_iter = c->iter_input;
+      skippy_iter.reset (c->buffer->idx, 1);
+      skippy_iter.set_match_func (match_always, nullptr, &Null(HBUINT16));
+      if (skippy_iter.next () &&
+	  skippy_iter.may_skip (c->buffer->info[skippy_iter.idx]) == hb_ot_apply_context_t::matcher_t::SKIP_NO)
+	second = c->buffer->info[skippy_iter.idx].codepoint;
+    }
+
     for (unsigned int i = 0; i < num_ligs; i++)
     {
       const Ligature &lig = this+ligature[i];
+      if (second != HB_SET_VALUE_INVALID && !lig.may_match_second (second))
+	continue;
       if (lig.apply (c)) return_trace (true);
     }
 
@@ -1511,7 +1538,10 @@ template <typename context_t>
   unsigned int saved_lookup_index = c->lookup_index;
   c->set_lookup_index (lookup_index);
   c->set_lookup_props (l.get_props ());
+  HB_BUFFER_COUNT (c->counters, visits, 1);
   bool ret = l.dispatch (c);
+  if (ret)
+    HB_BUFFER_COUNT (c->counters, applies, 1);
   c->set_lookup_index (saved_lookup_index);
   c->set_lookup_props (saved_lookup_props);
   return ret;
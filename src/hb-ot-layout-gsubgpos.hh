@@ -349,10 +349,22 @@ struct hb_ot_apply_context_t :
       /* Ignore ZWJ if we are matching context, or asked to. */
       matcher.set_ignore_zwj  (context_match || c->auto_zwj);
       matcher.set_mask (context_match ? -1 : c->lookup_mask);
+      update_skip_nothing (c->lookup_props);
     }
     inline void set_lookup_props (unsigned int lookup_props)
     {
       matcher.set_lookup_props (lookup_props);
+      update_skip_nothing (lookup_props);
+    }
+    /* If the lookup does not ignore any glyph classes and the buffer has
+     * no default-ignorables, may_skip() is SKIP_NO for every glyph, and
+     * next() / prev() reduce to comparing the adjacent glyph. */
+    inline void update_skip_nothing (unsigned int lookup_props)
+    {
+      skip_nothing = !(lookup_props & (LookupFlag::IgnoreFlags |
+				       LookupFlag::UseMarkFilteringSet |
+				       LookupFlag::MarkAttachmentType)) &&
+		     !(c->buffer->scratch_flags & HB_BUFFER_SCRATCH_FLAG_HAS_DEFAULT_IGNORABLES);
     }
     inline void set_match_func (matcher_t::match_func_t match_func_,
 				const void *match_data_,
@@ -376,15 +388,30 @@ struct hb_ot_apply_context_t :
     inline matcher_t::may_skip_t
     may_skip (const hb_glyph_info_t    &info) const
     {
+      if (skip_nothing)
+	return matcher_t::SKIP_NO;
       return matcher.may_skip (c, info);
     }
 
     inline bool next (void)
     {
       assert (num_items > 0);
+      if (skip_nothing)
+      {
+	if (idx + num_items >= end)
+	  return false;
+	idx++;
+	HB_BUFFER_COUNT (c->counters, skippy_steps, 1);
+	if (matcher.may_match (c->buffer->info[idx], match_glyph_data) == matcher_t::MATCH_NO)
+	  return false;
+	num_items--;
+	match_glyph_data++;
+	return true;
+      }
       while (idx + num_items < end)
       {
 	idx++;
+	HB_BUFFER_COUNT (c->counters, skippy_steps, 1);
 	const hb_glyph_info_t &info = c->buffer->info[idx];
 
 	matcher_t::may_skip_t skip = matcher.may_skip (c, info);
@@ -409,9 +436,22 @@ struct hb_ot_apply_context_t :
     inline bool prev (void)
     {
       assert (num_items > 0);
+      if (skip_nothing)
+      {
+	if (idx <= num_items - 1)
+	  return false;
+	idx--;
+	HB_BUFFER_COUNT (c->counters, skippy_steps, 1);
+	if (matcher.may_match (c->buffer->out_info[idx], match_glyph_data) == matcher_t::MATCH_NO)
+	  return false;
+	num_items--;
+	match_glyph_data++;
+	return true;
+      }
       while (idx > num_items - 1)
       {
 	idx--;
+	HB_BUFFER_COUNT (c->counters, skippy_steps, 1);
 	const hb_glyph_info_t &info = c->buffer->out_info[idx];
 
 	matcher_t::may_skip_t skip = matcher.may_skip (c, info);
@@ -439,11 +479,46 @@ struct hb_ot_apply_context_t :
     hb_ot_apply_context_t *c;
     matcher_t matcher;
     const HBUINT16 *match_glyph_data;
+    bool skip_nothing;
 
     unsigned int num_items;
     unsigned int end;
   };
 
+  /* Outcome of the last backward base / ligature search done by
+   * MarkBasePos / MarkLigPos.  GPOS does not modify glyph info, so
+   * a search started at a later position finds the same glyph, as long
+   * as the iterator skips every glyph in between; typically the marks
+   * of the stack already processed. */
+  struct base_memo_t
+  {
+    enum kind_t {
+      NONE,
+      MARK_BASE,
+      MARK_LIG
+    };
+
+    inline void clear (void) { kind = NONE; }
+
+    kind_t kind;
+    unsigned int lookup_index;
+    hb_mask_t lookup_mask;
+    uint8_t syllable;
+    unsigned int start;
+    unsigned int result; /* (unsigned int) -1 if the search failed. */
+  };
+
+  /* Glyphs start..end-1, all in cluster, as last seen by
+   * unsafe_to_break_to_cur(). */
+  struct cluster_run_t
+  {
+    inline void clear (void) { start = end = cluster = 0; }
+
+    unsigned int start;
+    unsigned int end;
+    unsigned int cluster;
+  };
+
 
   inline const char *get_name (void) { return "APPLY"; }
   typedef return_t (*recurse_func_t) (hb_ot_apply_context_t *c, unsigned int lookup_index);
@@ -469,6 +544,7 @@ struct hb_ot_apply_context_t :
   hb_buffer_t *buffer;
   recurse_func_t recurse_func;
   const GDEF &gdef;
+  const GDEF::accelerator_t &gdef_accel;
   const VariationStore &var_store;
 
   hb_direction_t direction;
@@ -486,6 +562,10 @@ struct hb_ot_apply_context_t :
 
   uint32_t random_state;
 
+  base_memo_t base_memo;
+  cluster_run_t cluster_run;
+
+  hb_buffer_lookup_counters_t *counters; /* Of the current lookup; nullptr unless collecting. */
 
   hb_ot_apply_context_t (unsigned int table_index_,
 		      hb_font_t *font_,
@@ -494,6 +574,7 @@ struct hb_ot_apply_context_t :
 			font (font_), face (font->face), buffer (buffer_),
 			recurse_func (nullptr),
 			gdef (_get_gdef (face)),
+			gdef_accel (_get_gdef_accel (face)),
 			var_store (gdef.get_var_store ()),
 			direction (buffer_->props.direction),
 			lookup_mask (1),
@@ -506,7 +587,8 @@ struct hb_ot_apply_context_t :
 			auto_zwnj (true),
 			auto_zwj (true),
 			random (false),
-			random_state (1) { init_iters (); }
+			random_state (1),
+			counters (nullptr) { init_iters (); base_memo.clear (); cluster_run.clear (); }
 
   inline void init_iters (void)
   {
@@ -519,7 +601,11 @@ struct hb_ot_apply_context_t :
   inline void set_auto_zwnj (bool auto_zwnj_) { auto_zwnj = auto_zwnj_; init_iters (); }
   inline void set_random (bool random_) { random = random_; }
   inline void set_recurse_func (recurse_func_t func) { recurse_func = func; }
-  inline void set_lookup_index (unsigned int lookup_index_) { lookup_index = lookup_index_; }
+  inline void set_lookup_index (unsigned int lookup_index_)
+  {
+    lookup_index = lookup_index_;
+    counters = buffer->get_lookup_counters (table_index, lookup_index);
+  }
   inline void set_lookup_props (unsigned int lookup_props_) { lookup_props = lookup_props_; init_iters (); }
 
   inline uint32_t random_number (void)
@@ -529,6 +615,64 @@ struct hb_ot_apply_context_t :
     return random_state;
   }
 
+  /* Must be called with iter_input set up for the search at hand.  On a
+   * hit, the memo moves up to the current glyph, such that each glyph of
+   * a mark stack is walked over once, not once per later mark. */
+  inline bool get_base_memo (base_memo_t::kind_t kind, unsigned int *result)
+  {
+    unsigned int start = buffer->idx;
+    if (base_memo.kind != kind ||
+	base_memo.lookup_index != lookup_index ||
+	base_memo.lookup_mask != lookup_mask ||
+	base_memo.syllable != buffer->cur().syllable () ||
+	base_memo.start > start)
+      return false;
+    for (unsigned int i = base_memo.start; i < start; i++)
+      if (iter_input.may_skip (buffer->info[i]) == matcher_t::SKIP_NO)
+	return false;
+    base_memo.start = start;
+    *result = base_memo.result;
+    return true;
+  }
+  inline void set_base_memo (base_memo_t::kind_t kind, unsigned int result)
+  {
+    base_memo.kind = kind;
+    base_memo.lookup_index = lookup_index;
+    base_memo.lookup_mask = lookup_mask;
+    base_memo.syllable = buffer->cur().syllable ();
+    base_memo.start = buffer->idx;
+    base_memo.result = result;
+  }
+
+  /* Same as buffer->unsafe_to_break (start, buffer->idx), which does
+   * nothing while those glyphs all are in one cluster.  That is checked
+   * for incrementally, such that for a stack of marks on one base each
+   * glyph is looked at once, not once per later mark.  Positioning does
+   * not change clusters, so a run once seen stays valid. */
+  inline void unsafe_to_break_to_cur (unsigned int start)
+  {
+    const hb_glyph_info_t *info = buffer->info;
+    unsigned int end = buffer->idx;
+    if (unlikely (start >= end))
+      return;
+
+    unsigned int cluster = info[start].cluster;
+    unsigned int i = start;
+    if (cluster_run.start == start && cluster_run.cluster == cluster)
+      i = MIN (cluster_run.end, end);
+    while (i < end && info[i].cluster == cluster)
+      i++;
+    if (cluster_run.start != start || cluster_run.cluster != cluster || i > cluster_run.end)
+    {
+      cluster_run.start = start;
+      cluster_run.end = i;
+      cluster_run.cluster = cluster;
+    }
+
+    if (i < end)
+      buffer->unsafe_to_break (start, end);
+  }
+
   inline bool
   match_properties_mark (hb_codepoint_t  glyph,
 			 unsigned int    glyph_props,
@@ -538,7 +682,7 @@ struct hb_ot_apply_context_t :
      * match_props has the set index.
      */
     if (match_props & LookupFlag::UseMarkFilteringSet)
-      return gdef.mark_set_covers (match_props >> 16, glyph);
+      return gdef_accel.mark_set_covers (match_props >> 16, glyph);
 
     /* The second byte of match_props has the meaning
      * "ignore marks of attachment type different than
@@ -591,7 +735,7 @@ struct hb_ot_apply_context_t :
     if (component)
       add_in |= HB_OT_LAYOUT_GLYPH_PROPS_MULTIPLIED;
     if (likely (has_glyph_classes))
-      _hb_glyph_info_set_glyph_props (&buffer->cur(), add_in | gdef.get_glyph_props (glyph_index));
+      _hb_glyph_info_set_glyph_props (&buffer->cur(), add_in | gdef_accel.get_glyph_props (glyph_index));
     else if (class_guess)
       _hb_glyph_info_set_glyph_props (&buffer->cur(), add_in | class_guess);
   }
@@ -617,6 +761,7 @@ struct hb_ot_apply_context_t :
   {
     _set_glyph_props (glyph_index, class_guess, false, true);
     buffer->output_glyph (glyph_index);
+    HB_BUFFER_COUNT (counters, glyphs_inserted, 1);
   }
 };
 
@@ -752,6 +897,10 @@ static inline void collect_array (hb_collect_glyphs_context_t *c HB_UNUSED,
 }
 
 
+static inline bool match_always (hb_codepoint_t glyph_id HB_UNUSED, const HBUINT16 &value HB_UNUSED, const void *data HB_UNUSED)
+{
+  return true;
+}
 static inline bool match_glyph (hb_codepoint_t glyph_id, const HBUINT16 &value, const void *data HB_UNUSED)
 {
   return glyph_id == value;
@@ -995,6 +1144,7 @@ static inline bool ligate_input (hb_ot_apply_context_t *c,
 
     /* Skip the base glyph */
     buffer->idx++;
+    HB_BUFFER_COUNT (c->counters, glyphs_removed, 1);
   }
 
   if (!is_mark_ligature && last_lig_id) {
@@ -2639,12 +2789,20 @@ struct hb_ot_layout_lookup_accelerator_t
 
   inline bool may_have (hb_codepoint_t g) const
   { return digest.may_have (g); }
+  inline bool may_intersect (const hb_set_digest_t &d) const
+  { return digest.may_intersect (d); }
+
+  inline unsigned int get_memory_usage (void) const
+  { return subtables.get_memory_usage (); }
 
   inline bool apply (hb_ot_apply_context_t *c) const
   {
      for (unsigned int i = 0; i < subtables.len; i++)
+     {
+       HB_BUFFER_COUNT (c->counters, subtables_tried, 1);
        if (subtables[i].apply (c))
          return true;
+     }
      return false;
   }
 
@@ -2755,26 +2913,68 @@ struct GSUBGPOS
 
       this->lookup_count = table->get_lookup_count ();
 
-      this->accels = (hb_ot_layout_lookup_accelerator_t *) calloc (this->lookup_count, sizeof (hb_ot_layout_lookup_accelerator_t));
+      /* The lookup accelerators themselves are built on first use; see
+       * get_accel(). */
+      this->accels = (hb_atomic_ptr_t<hb_ot_layout_lookup_accelerator_t> *) calloc (this->lookup_count, sizeof (this->accels[0]));
       if (unlikely (!this->accels))
         this->lookup_count = 0;
-
-      for (unsigned int i = 0; i < this->lookup_count; i++)
-	this->accels[i].init (table->get_lookup (i));
     }
 
     inline void fini (void)
     {
       for (unsigned int i = 0; i < this->lookup_count; i++)
-	this->accels[i].fini ();
+      {
+	hb_ot_layout_lookup_accelerator_t *accel = this->accels[i].get ();
+	if (accel)
+	{
+	  accel->fini ();
+	  free (accel);
+	}
+      }
       free (this->accels);
       hb_blob_destroy (this->blob);
     }
 
+    /* Counts only the lookup accelerators built so far. */
+    inline unsigned int get_memory_usage (void) const
+    {
+      unsigned int usage = this->lookup_count * sizeof (this->accels[0]);
+      for (unsigned int i = 0; i < this->lookup_count; i++)
+      {
+	const hb_ot_layout_lookup_accelerator_t *accel = this->accels[i].get ();
+	if (accel)
+	  usage += sizeof (*accel) + accel->get_memory_usage ();
+      }
+      return usage;
+    }
+
+    inline const hb_ot_layout_lookup_accelerator_t &get_accel (unsigned int lookup_index) const
+    {
+      if (unlikely (lookup_index >= this->lookup_count))
+	return Null(hb_ot_layout_lookup_accelerator_t);
+
+    retry:
+      hb_ot_layout_lookup_accelerator_t *accel = this->accels[lookup_index].get ();
+      if (unlikely (!accel))
+      {
+	accel = (hb_ot_layout_lookup_accelerator_t *) calloc (1, sizeof (hb_ot_layout_lookup_accelerator_t));
+	if (unlikely (!accel))
+	  return Null(hb_ot_layout_lookup_accelerator_t);
+	accel->init (table->get_lookup (lookup_index));
+	if (unlikely (!this->accels[lookup_index].cmpexch (nullptr, accel)))
+	{
+	  accel->fini ();
+	  free (accel);
+	  goto retry;
+	}
+      }
+      return *accel;
+    }
+
     hb_blob_t *blob;
     const T *table;
     unsigned int lookup_count;
-    hb_ot_layout_lookup_accelerator_t *accels;
+    hb_atomic_ptr_t<hb_ot_layout_lookup_accelerator_t> *accels;
   };
 
   protected:
@@ -59,6 +59,11 @@ const OT::GDEF& _get_gdef (hb_face_t *face)
   if (unlikely (!hb_ot_shaper_face_data_ensure (face))) return Null(OT::GDEF);
   return *hb_ot_face_data (face)->GDEF->table;
 }
+const OT::GDEF_accelerator_t& _get_gdef_accel (hb_face_t *face)
+{
+  if (unlikely (!hb_ot_shaper_face_data_ensure (face))) return Null(OT::GDEF_accelerator_t);
+  return *hb_ot_face_data (face)->GDEF;
+}
 static hb_blob_t * _get_gsub_blob (hb_face_t *face)
 {
   if (unlikely (!hb_ot_shaper_face_data_ensure (face))) return hb_blob_get_empty ();
@@ -228,6 +233,10 @@ OT::GDEF::accelerator_t::init (hb_face_t *face)
   }
 
   table = this->blob->as<GDEF> ();
+
+  glyph_props.init ();
+  mark_sets.init ();
+  flatten (face->get_num_glyphs ());
 }
 
 static void
@@ -236,7 +245,7 @@ _hb_ot_layout_set_glyph_props (hb_font_t *font,
 {
   _hb_buffer_assert_gsubgpos_vars (buffer);
 
-  const OT::GDEF &gdef = _get_gdef (font->face);
+  const OT::GDEF::accelerator_t &gdef = _get_gdef_accel (font->face);
   unsigned int count = buffer->len;
   for (unsigned int i = 0; i < count; i++)
   {
@@ -973,7 +982,7 @@ hb_ot_layout_lookup_would_substitute_fast (hb_face_t            *face,
 
   const OT::SubstLookup& l = hb_ot_face_data (face)->GSUB->table->get_lookup (lookup_index);
 
-  return l.would_apply (&c, &hb_ot_face_data (face)->GSUB->accels[lookup_index]);
+  return l.would_apply (&c, &hb_ot_face_data (face)->GSUB->get_accel (lookup_index));
 }
 
 void
@@ -1018,24 +1027,112 @@ hb_ot_layout_lookups_substitute_closure (hb_face_t      *face,
   OT::hb_closure_context_t c (face, glyphs, &done_lookups);
   const OT::GSUB& gsub = _get_gsub (face);
 
+  hb_auto_t<hb_set_t> pending;
+  if (lookups != nullptr)
+    pending.union_ (lookups);
+  else if (gsub.get_lookup_count ())
+    pending.add_range (0, gsub.get_lookup_count () - 1);
+
+  /* Instead of visiting all lookups until no glyphs are added, only visit
+   * those again that may match a glyph added since.  What single, multiple
+   * and alternate substitutions add only depends on their coverage, which
+   * the lookup accelerators keep a digest of, and on each input glyph on its
+   * own; these remember the glyphs they were run on and are only run on the
+   * rest when visited again.  Other lookups also depend on components,
+   * context or the lookups they recurse to, and are always visited again
+   * in full. */
+  hb_auto_t<hb_vector_t<unsigned int> > lookup_indices;
+  hb_auto_t<hb_vector_t<const OT::hb_ot_layout_lookup_accelerator_t *> > accels;
+  hb_vector_t<hb_set_t> done_glyphs;
+  done_glyphs.init ();
+  hb_auto_t<hb_set_t> before, added_glyphs, new_glyphs;
+  bool incremental = true;
   unsigned int iteration_count = 0;
-  unsigned int glyphs_length;
-  do
+  while (iteration_count++ <= HB_CLOSURE_MAX_STAGES && !pending.is_empty ())
   {
-    glyphs_length = glyphs->get_population ();
-    if (lookups != nullptr)
-    {
-      for (hb_codepoint_t lookup_index = HB_SET_VALUE_INVALID; hb_set_next (lookups, &lookup_index);)
-        gsub.get_lookup (lookup_index).closure (&c, lookup_index);
-    }
+    before.set (glyphs);
+    if (iteration_count == 1 || unlikely (!incremental))
+      for (hb_codepoint_t lookup_index = HB_SET_VALUE_INVALID; pending.next (&lookup_index);)
+	gsub.get_lookup (lookup_index).closure (&c, lookup_index);
     else
+      for (unsigned int i = 0; i < lookup_indices.len; i++)
+      {
+	if (!pending.has (lookup_indices[i]))
+	  continue;
+	const OT::SubstLookup &lookup = gsub.get_lookup (lookup_indices[i]);
+	if (!accels[i])
+	{
+	  lookup.closure (&c, lookup_indices[i]);
+	  continue;
+	}
+
+	new_glyphs.set (glyphs);
+	new_glyphs.subtract (&done_glyphs[i]);
+	done_glyphs[i].set (glyphs);
+	{
+	  OT::hb_closure_context_t new_c (face, &new_glyphs, &done_lookups);
+	  lookup.dispatch (&new_c);
+	}
+	glyphs->union_ (&new_glyphs);
+      }
+
+    if (before.get_population () == glyphs->get_population ())
+      break;
+
+    if (iteration_count == 1)
     {
-      for (unsigned int i = 0; i < gsub.get_lookup_count (); i++)
-        gsub.get_lookup (i).closure (&c, i);
+      /* All lookups were visited once; sort them out for the next rounds. */
+      const OT::GSUB::accelerator_t &gsub_accel = *hb_ot_face_data (face)->GSUB;
+      for (hb_codepoint_t lookup_index = HB_SET_VALUE_INVALID; pending.next (&lookup_index);)
+      {
+	const OT::SubstLookup &lookup = gsub.get_lookup (lookup_index);
+	unsigned int type = lookup.get_type ();
+	if (type == OT::SubstLookupSubTable::Extension)
+	  type = CastR<OT::ExtensionSubst> (lookup.get_subtable (0)).get_type ();
+
+	const OT::hb_ot_layout_lookup_accelerator_t *accel = nullptr;
+	if (type == OT::SubstLookupSubTable::Single ||
+	    type == OT::SubstLookupSubTable::Multiple ||
+	    type == OT::SubstLookupSubTable::Alternate)
+	{
+	  accel = &gsub_accel.get_accel (lookup_index);
+	  if (unlikely (accel == &Null(OT::hb_ot_layout_lookup_accelerator_t)))
+	    accel = nullptr;
+	}
+	lookup_indices.push (lookup_index);
+	accels.push (accel);
+	hb_set_t *done = done_glyphs.push ();
+	if (unlikely (lookup_indices.in_error () ||
+		      accels.in_error () ||
+		      done_glyphs.in_error ()))
+	{
+	  /* Out of memory; visit all lookups in full from now on. */
+	  incremental = false;
+	  break;
+	}
+	/* The first round ran each lookup on at least the glyphs it started
+	 * with. */
+	done->init ();
+	if (accel)
+	  done->set (&before);
+      }
     }
-    iteration_count++;
-  } while (iteration_count <= HB_CLOSURE_MAX_STAGES
-           && glyphs_length != glyphs->get_population ());
+    if (unlikely (!incremental))
+      continue;
+    pending.clear ();
+
+    added_glyphs.set (glyphs);
+    added_glyphs.subtract (&before);
+    hb_set_digest_t added_digest;
+    added_digest.init ();
+    for (hb_codepoint_t g = HB_SET_VALUE_INVALID; added_glyphs.next (&g);)
+      added_digest.add (g);
+
+    for (unsigned int i = 0; i < lookup_indices.len; i++)
+      if (!accels[i] || accels[i]->may_intersect (added_digest))
+	pending.add (lookup_indices[i]);
+  }
+  done_glyphs.fini_deep ();
 }
 
 /*
@@ -1253,10 +1350,10 @@ struct GSUBProxy
 
   GSUBProxy (hb_face_t *face) :
     table (*hb_ot_face_data (face)->GSUB->table),
-    accels (hb_ot_face_data (face)->GSUB->accels) {}
+    accel (*hb_ot_face_data (face)->GSUB) {}
 
   const OT::GSUB &table;
-  const OT::hb_ot_layout_lookup_accelerator_t *accels;
+  const OT::GSUB::accelerator_t &accel;
 };
 
 struct GPOSProxy
@@ -1267,13 +1364,39 @@ struct GPOSProxy
 
   GPOSProxy (hb_face_t *face) :
     table (*hb_ot_face_data (face)->GPOS->table),
-    accels (hb_ot_face_data (face)->GPOS->accels) {}
+    accel (*hb_ot_face_data (face)->GPOS) {}
 
   const OT::GPOS &table;
-  const OT::hb_ot_layout_lookup_accelerator_t *accels;
+  const OT::GPOS::accelerator_t &accel;
 };
 
 
+/* Returns the index of the first glyph at or after start that the lookup
+ * may apply to, or buffer->len if none.  This is a tight loop over the
+ * input array that does not touch the output buffer, such that long runs
+ * of glyphs a lookup does not care about can be passed over in bulk. */
+static inline unsigned int
+next_candidate (OT::hb_ot_apply_context_t *c,
+		const OT::hb_ot_layout_lookup_accelerator_t &accel,
+		unsigned int start)
+{
+  const hb_glyph_info_t *info = c->buffer->info;
+  unsigned int count = c->buffer->len;
+  hb_mask_t lookup_mask = c->lookup_mask;
+  unsigned int rejects = 0;
+  unsigned int i;
+  for (i = start; i < count; i++)
+    if (info[i].mask & lookup_mask)
+    {
+      if (!accel.may_have (info[i].codepoint))
+	rejects++;
+      else if (c->check_glyph_property (&info[i], c->lookup_props))
+	break;
+    }
+  HB_BUFFER_COUNT (c->counters, digest_rejects, rejects);
+  return i;
+}
+
 static inline bool
 apply_forward (OT::hb_ot_apply_context_t *c,
 	       const OT::hb_ot_layout_lookup_accelerator_t &accel)
@@ -1282,16 +1405,18 @@ apply_forward (OT::hb_ot_apply_context_t *c,
   hb_buffer_t *buffer = c->buffer;
   while (buffer->idx < buffer->len && buffer->successful)
   {
-    bool applied = false;
-    if (accel.may_have (buffer->cur().codepoint) &&
-	(buffer->cur().mask & c->lookup_mask) &&
-	c->check_glyph_property (&buffer->cur(), c->lookup_props))
-     {
-       applied = accel.apply (c);
-     }
-
-    if (applied)
+    unsigned int next = next_candidate (c, accel, buffer->idx);
+    if (next > buffer->idx)
+    {
+      buffer->next_glyphs (next - buffer->idx);
+      continue;
+    }
+
+    if (accel.apply (c))
+    {
+      HB_BUFFER_COUNT (c->counters, applies, 1);
       ret = true;
+    }
     else
       buffer->next_glyph ();
   }
@@ -1306,12 +1431,17 @@ apply_backward (OT::hb_ot_apply_context_t *c,
   hb_buffer_t *buffer = c->buffer;
   do
   {
-    if (accel.may_have (buffer->cur().codepoint) &&
-	(buffer->cur().mask & c->lookup_mask) &&
-	c->check_glyph_property (&buffer->cur(), c->lookup_props))
+    /* Like next_candidate (), only counts glyphs the mask selects. */
+    if (buffer->cur().mask & c->lookup_mask)
     {
-     if (accel.apply (c))
-       ret = true;
+      if (!accel.may_have (buffer->cur().codepoint))
+	HB_BUFFER_COUNT (c->counters, digest_rejects, 1);
+      else if (c->check_glyph_property (&buffer->cur(), c->lookup_props) &&
+	       accel.apply (c))
+      {
+	HB_BUFFER_COUNT (c->counters, applies, 1);
+	ret = true;
+      }
     }
     /* The reverse lookup doesn't "advance" cursor (for good reason). */
     buffer->idx--;
@@ -1333,6 +1463,7 @@ apply_string (OT::hb_ot_apply_context_t *c,
     return;
 
   c->set_lookup_props (lookup.get_props ());
+  HB_BUFFER_COUNT (c->counters, visits, 1);
 
   if (likely (!lookup.is_reverse ()))
   {
@@ -1372,9 +1503,13 @@ inline void hb_ot_map_t::apply (const Proxy &proxy,
   unsigned int i = 0;
   OT::hb_ot_apply_context_t c (table_index, font, buffer);
   c.set_recurse_func (Proxy::Lookup::apply_recurse_func);
+  if (buffer->collecting_counters ())
+    buffer->prepare_lookup_counters (table_index, proxy.table.get_lookup_count ());
 
+  const char *table_name = table_index ? "GPOS" : "GSUB";
   for (unsigned int stage_index = 0; stage_index < stages[table_index].len; stage_index++) {
     const stage_map_t *stage = &stages[table_index][stage_index];
+    buffer->trace_begin (font, table_name, stage_index);
     for (; i < stage->last_lookup; i++)
     {
       unsigned int lookup_index = lookups[table_index][i].index;
@@ -1390,14 +1525,17 @@ inline void hb_ot_map_t::apply (const Proxy &proxy,
       }
       apply_string<Proxy> (&c,
 			   proxy.table.get_lookup (lookup_index),
-			   proxy.accels[lookup_index]);
+			   proxy.accel.get_accel (lookup_index));
       (void) buffer->message (font, "end lookup %d", lookup_index);
     }
+    buffer->trace_end (font, table_name, stage_index);
 
     if (stage->pause_func)
     {
+      buffer->trace_begin (font, table_index ? "GPOS-pause" : "GSUB-pause", stage_index);
       buffer->clear_output ();
       stage->pause_func (plan, font, buffer);
+      buffer->trace_end (font, table_index ? "GPOS-pause" : "GSUB-pause", stage_index);
     }
   }
 }
@@ -40,11 +40,13 @@
 namespace OT
 {
   struct GDEF;
+  struct GDEF_accelerator_t;
   struct GSUB;
   struct GPOS;
 }
 
 HB_INTERNAL const OT::GDEF& _get_gdef (hb_face_t *face);
+HB_INTERNAL const OT::GDEF_accelerator_t& _get_gdef_accel (hb_face_t *face);
 HB_INTERNAL const OT::GSUB& _get_gsub_relaxed (hb_face_t *face);
 HB_INTERNAL const OT::GPOS& _get_gpos_relaxed (hb_face_t *face);
 
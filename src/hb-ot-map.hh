@@ -153,6 +153,13 @@ struct hb_ot_map_t
   HB_INTERNAL void substitute (const struct hb_ot_shape_plan_t *plan, hb_font_t *font, hb_buffer_t *buffer) const;
   HB_INTERNAL void position (const struct hb_ot_shape_plan_t *plan, hb_font_t *font, hb_buffer_t *buffer) const;
 
+  inline unsigned int get_memory_usage (void) const
+  {
+    return features.get_memory_usage () +
+	   lookups[0].get_memory_usage () + lookups[1].get_memory_usage () +
+	   stages[0].get_memory_usage () + stages[1].get_memory_usage ();
+  }
+
   public:
   hb_tag_t chosen_script[2];
   bool found_script[2];
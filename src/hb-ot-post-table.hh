@@ -162,6 +162,34 @@ struct post
       if (unlikely (!len))
 	return false;
 
+      const uint16_t *gids = get_gids_sorted_by_name ();
+      if (unlikely (!gids))
+	return false; /* Anything better?! */
+
+      hb_bytes_t st (name, len);
+      const uint16_t *gid = (const uint16_t *) hb_bsearch_r (&st, gids, count, sizeof (gids[0]), cmp_key, (void *) this);
+      if (gid)
+      {
+	*glyph = *gid;
+	return true;
+      }
+
+      return false;
+    }
+
+    inline unsigned int get_memory_usage (void) const
+    {
+      return index_to_offset.get_memory_usage () +
+	     (gids_sorted_by_name.get () ? get_glyph_count () * sizeof (uint16_t) : 0);
+    }
+
+    /* Built on first use; returns nullptr on allocation failure. */
+    inline const uint16_t *get_gids_sorted_by_name (void) const
+    {
+      unsigned int count = get_glyph_count ();
+      if (unlikely (!count))
+	return nullptr;
+
     retry:
       uint16_t *gids = gids_sorted_by_name.get ();
 
@@ -169,7 +197,7 @@ struct post
       {
 	gids = (uint16_t *) malloc (count * sizeof (gids[0]));
 	if (unlikely (!gids))
-	  return false; /* Anything better?! */
+	  return nullptr;
 
 	for (unsigned int i = 0; i < count; i++)
 	  gids[i] = i;
@@ -181,16 +209,7 @@ struct post
 	  goto retry;
 	}
       }
-
-      hb_bytes_t st (name, len);
-      const uint16_t *gid = (const uint16_t *) hb_bsearch_r (&st, gids, count, sizeof (gids[0]), cmp_key, (void *) this);
-      if (gid)
-      {
-	*glyph = *gid;
-	return true;
-      }
-
-      return false;
+      return gids;
     }
 
     protected:
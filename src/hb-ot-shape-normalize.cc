@@ -174,6 +174,8 @@ decompose_current_character (const hb_ot_shape_normalize_context_t *c, bool shor
 
   if (decompose (c, shortest, u))
   {
+    if (buffer->collecting_counters ())
+      buffer->decompositions++;
     skip_char (buffer);
     return;
   }
@@ -687,9 +687,13 @@ hb_ot_substitute_default (const hb_ot_shape_context_t *c)
 
   HB_BUFFER_ALLOCATE_VAR (buffer, glyph_index);
 
+  buffer->trace_begin (c->font, "normalize");
   _hb_ot_shape_normalize (c->plan, buffer, c->font);
+  buffer->trace_end (c->font, "normalize");
 
+  buffer->trace_begin (c->font, "setup-masks");
   hb_ot_shape_setup_masks (c);
+  buffer->trace_end (c->font, "setup-masks");
 
   /* This is unfortunate to go here, but necessary... */
   if (c->plan->fallback_mark_positioning)
@@ -711,7 +715,11 @@ hb_ot_substitute_complex (const hb_ot_shape_context_t *c)
     hb_synthesize_glyph_classes (c);
 
   if (unlikely (c->plan->apply_morx))
+  {
+    buffer->trace_begin (c->font, "morx");
     hb_aat_layout_substitute (c->plan, c->font, c->buffer);
+    buffer->trace_end (c->font, "morx");
+  }
   else
     c->plan->substitute (c->font, buffer);
 }
@@ -719,11 +727,15 @@ hb_ot_substitute_complex (const hb_ot_shape_context_t *c)
 static inline void
 hb_ot_substitute (const hb_ot_shape_context_t *c)
 {
+  c->buffer->trace_begin (c->font, "substitute");
+
   hb_ot_substitute_default (c);
 
   _hb_buffer_allocate_gsubgpos_vars (c->buffer);
 
   hb_ot_substitute_complex (c);
+
+  c->buffer->trace_end (c->font, "substitute");
 }
 
 /* Position */
@@ -837,7 +849,11 @@ hb_ot_position_complex (const hb_ot_shape_context_t *c)
   if (c->plan->apply_gpos)
     c->plan->position (c->font, c->buffer);
   else if (c->plan->apply_kerx)
+  {
+    c->buffer->trace_begin (c->font, "kerx");
     hb_aat_layout_position (c->plan, c->font, c->buffer);
+    c->buffer->trace_end (c->font, "kerx");
+  }
 
   if (c->plan->apply_trak)
     hb_aat_layout_track (c->plan, c->font, c->buffer);
@@ -858,7 +874,9 @@ hb_ot_position_complex (const hb_ot_shape_context_t *c)
   /* Finishing off GPOS has to follow a certain order. */
   hb_ot_layout_position_finish_advances (c->font, c->buffer);
   hb_ot_zero_width_default_ignorables (c);
+  c->buffer->trace_begin (c->font, "attach-offsets");
   hb_ot_layout_position_finish_offsets (c->font, c->buffer);
+  c->buffer->trace_end (c->font, "attach-offsets");
 
   /* The nil glyph_h_origin() func returns 0, so no need to apply it. */
   if (c->font->has_glyph_h_origin_func ())
@@ -871,14 +889,22 @@ hb_ot_position_complex (const hb_ot_shape_context_t *c)
 static inline void
 hb_ot_position (const hb_ot_shape_context_t *c)
 {
+  c->buffer->trace_begin (c->font, "position");
+
   c->buffer->clear_positions ();
 
+  c->buffer->trace_begin (c->font, "advances");
   hb_ot_position_default (c);
+  c->buffer->trace_end (c->font, "advances");
 
   hb_ot_position_complex (c);
 
   if (c->plan->fallback_mark_positioning && c->plan->shaper->fallback_position)
+  {
+    c->buffer->trace_begin (c->font, "fallback-mark-position");
     _hb_ot_shape_fallback_mark_position (c->plan, c->font, c->buffer);
+    c->buffer->trace_end (c->font, "fallback-mark-position");
+  }
 
   if (HB_DIRECTION_IS_BACKWARD (c->buffer->props.direction))
     hb_buffer_reverse (c->buffer);
@@ -886,11 +912,21 @@ hb_ot_position (const hb_ot_shape_context_t *c)
   /* Visual fallback goes here. */
 
   if (c->plan->apply_kern)
+  {
+    c->buffer->trace_begin (c->font, "kern");
     hb_ot_layout_kern (c->font, c->buffer, c->plan->kern_mask);
+    c->buffer->trace_end (c->font, "kern");
+  }
   else if (c->plan->fallback_kerning)
+  {
+    c->buffer->trace_begin (c->font, "fallback-kern");
     _hb_ot_shape_fallback_kern (c->plan, c->font, c->buffer);
+    c->buffer->trace_end (c->font, "fallback-kern");
+  }
 
   _hb_buffer_deallocate_gsubgpos_vars (c->buffer);
+
+  c->buffer->trace_end (c->font, "position");
 }
 
 static inline void
@@ -937,6 +973,8 @@ hb_ot_shape_internal (hb_ot_shape_context_t *c)
 			      (unsigned) HB_BUFFER_MAX_OPS_MIN);
   }
 
+  c->buffer->trace_begin (c->font, "shape");
+
   /* Save the original direction, we use it later. */
   c->target_direction = c->buffer->props.direction;
 
@@ -944,6 +982,7 @@ hb_ot_shape_internal (hb_ot_shape_context_t *c)
 
   c->buffer->clear_output ();
 
+  c->buffer->trace_begin (c->font, "unicode-props");
   hb_ot_shape_initialize_masks (c);
   hb_set_unicode_props (c->buffer);
   hb_insert_dotted_circle (c->buffer, c->font);
@@ -951,17 +990,28 @@ hb_ot_shape_internal (hb_ot_shape_context_t *c)
   hb_form_clusters (c->buffer);
 
   hb_ensure_native_direction (c->buffer);
+  c->buffer->trace_end (c->font, "unicode-props");
 
   if (c->plan->shaper->preprocess_text)
+  {
+    c->buffer->trace_begin (c->font, "preprocess-text");
     c->plan->shaper->preprocess_text (c->plan, c->buffer, c->font);
+    c->buffer->trace_end (c->font, "preprocess-text");
+  }
 
   hb_ot_substitute (c);
   hb_ot_position (c);
 
+  c->buffer->trace_begin (c->font, "hide-default-ignorables");
   hb_ot_hide_default_ignorables (c);
+  c->buffer->trace_end (c->font, "hide-default-ignorables");
 
   if (c->plan->shaper->postprocess_glyphs)
+  {
+    c->buffer->trace_begin (c->font, "postprocess-glyphs");
     c->plan->shaper->postprocess_glyphs (c->plan, c->buffer, c->font);
+    c->buffer->trace_end (c->font, "postprocess-glyphs");
+  }
 
   hb_propagate_flags (c->buffer);
 
@@ -972,6 +1022,8 @@ hb_ot_shape_internal (hb_ot_shape_context_t *c)
   c->buffer->max_len = HB_BUFFER_MAX_LEN_DEFAULT;
   c->buffer->max_ops = HB_BUFFER_MAX_OPS_DEFAULT;
   c->buffer->deallocate_var_all ();
+
+  c->buffer->trace_end (c->font, "shape");
 }
 
 
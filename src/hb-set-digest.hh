@@ -105,6 +105,9 @@ struct hb_set_digest_lowest_bits_t
   inline bool may_have (hb_codepoint_t g) const {
     return !!(mask & mask_for (g));
   }
+  inline bool may_intersect (const hb_set_digest_lowest_bits_t &o) const {
+    return !!(mask & o.mask);
+  }
 
   private:
 
@@ -151,6 +154,9 @@ struct hb_set_digest_combiner_t
   inline bool may_have (hb_codepoint_t g) const {
     return head.may_have (g) && tail.may_have (g);
   }
+  inline bool may_intersect (const hb_set_digest_combiner_t &o) const {
+    return head.may_intersect (o.head) && tail.may_intersect (o.tail);
+  }
 
   private:
   head_t head;
@@ -208,6 +208,9 @@ struct hb_set_t
     fini_shallow ();
   }
 
+  inline unsigned int get_memory_usage (void) const
+  { return page_map.get_memory_usage () + pages.get_memory_usage (); }
+
   inline bool resize (unsigned int count)
   {
     if (unlikely (!successful)) return false;
@@ -669,7 +672,7 @@ struct hb_set_t
 	return nullptr;
 
       pages[map.index].init0 ();
-      memmove (&page_map[i + 1], &page_map[i], (page_map.len - 1 - i) * sizeof (page_map[0]));
+      memmove (page_map.arrayZ() + i + 1, page_map.arrayZ() + i, (page_map.len - 1 - i) * sizeof (page_map[0]));
       page_map[i] = map;
     }
     return &pages[page_map[i].index];
@@ -29,6 +29,8 @@
 #include "hb-shaper.hh"
 #include "hb-font.hh"
 #include "hb-buffer.hh"
+#include "hb-machinery.hh"
+#include "hb-ot-shape.hh"
 
 
 static void
@@ -580,3 +582,43 @@ hb_shape_plan_get_shaper (hb_shape_plan_t *shape_plan)
 {
   return shape_plan->shaper_name;
 }
+
+/**
+ * hb_shape_plan_get_memory_usage:
+ * @shape_plan: a shape plan.
+ * @usage_count: (inout) (optional): input length of @usage array, output
+ *               number of items written.
+ * @usage: (out) (array length=usage_count) (optional): array to write the
+ *         usage of each subsystem into.
+ *
+ * Reports the heap memory used by @shape_plan, per subsystem.  Data
+ * private to the script-specific shapers is not counted.
+ *
+ * Return value: total heap memory used by @shape_plan, in bytes, including
+ * subsystems that did not fit in @usage.
+ *
+ * Since: REPLACEME
+ **/
+unsigned int
+hb_shape_plan_get_memory_usage (hb_shape_plan_t   *shape_plan,
+				unsigned int      *usage_count, /* IN/OUT */
+				hb_memory_usage_t *usage /* OUT */)
+{
+  hb_memory_usage_accumulator_t c (usage_count, usage);
+  if (unlikely (hb_object_is_inert (shape_plan)))
+    return 0;
+
+  c.add (HB_MEMORY_USAGE_OBJECT, sizeof (*shape_plan) +
+				 shape_plan->num_user_features * sizeof (shape_plan->user_features[0]) +
+				 shape_plan->num_coords * sizeof (shape_plan->coords[0]));
+
+  void *data = shape_plan->shaper_data.ot.get ();
+  if (data && data != HB_SHAPER_DATA_INVALID && data != HB_SHAPER_DATA_SUCCEEDED)
+  {
+    const hb_ot_shape_plan_t *plan = (const hb_ot_shape_plan_t *) data;
+    c.add (HB_MEMORY_USAGE_OBJECT, sizeof (*plan));
+    c.add (HB_MEMORY_USAGE_LOOKUP_MAP, plan->map.get_memory_usage ());
+  }
+
+  return c.total;
+}
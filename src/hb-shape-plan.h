@@ -102,6 +102,11 @@ hb_shape_plan_execute (hb_shape_plan_t    *shape_plan,
 HB_EXTERN const char *
 hb_shape_plan_get_shaper (hb_shape_plan_t *shape_plan);
 
+HB_EXTERN unsigned int
+hb_shape_plan_get_memory_usage (hb_shape_plan_t   *shape_plan,
+				unsigned int      *usage_count, /* IN/OUT */
+				hb_memory_usage_t *usage /* OUT */);
+
 
 HB_END_DECLS
 
@@ -33,6 +33,22 @@
 #include "hb-ot-head-table.hh"
 #include "hb-ot-maxp-table.hh"
 
+#if defined(HAVE_MMAP) && defined(HAVE_MPROTECT) && defined(HAVE_SYS_MMAN_H) && !defined(HB_NO_MMAP)
+#include <sys/mman.h>
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+#ifdef MAP_ANONYMOUS
+#define HB_RESERVE_MMAP 1
+#endif
+#elif (defined(_WIN32) || defined(__CYGWIN__)) && !defined(HB_NO_MMAP)
+#include <windows.h>
+#define HB_RESERVE_WIN32 1
+#endif
+
 #ifndef HB_NO_VISIBILITY
 
 hb_vector_size_impl_t const _hb_NullPool[(HB_NULL_POOL_SIZE + sizeof (hb_vector_size_impl_t) - 1) / sizeof (hb_vector_size_impl_t)] = {};
@@ -63,4 +79,203 @@ hb_face_t::load_upem (void) const
   hb_blob_destroy (head_blob);
 }
 
+/* Like the OpenType table directory checksum; data is zero-padded to a
+ * multiple of four bytes. */
+static uint32_t
+_hb_face_table_checksum (hb_blob_t *blob)
+{
+  unsigned int length;
+  const uint8_t *p = (const uint8_t *) hb_blob_get_data (blob, &length);
+  uint32_t sum = 0;
+  unsigned int i;
+  for (i = 0; i + 4 <= length; i += 4)
+    sum += ((uint32_t) p[i] << 24) | ((uint32_t) p[i + 1] << 16) |
+	   ((uint32_t) p[i + 2] << 8) | (uint32_t) p[i + 3];
+  for (unsigned int j = 0; i + j < length; j++)
+    sum += (uint32_t) p[i + j] << (24 - 8 * j);
+  return sum;
+}
+
+bool
+_hb_face_table_is_trusted (const hb_face_t *face, hb_tag_t tag, hb_blob_t *blob)
+{
+  hb_face_trust_t *trust = face->trust;
+  if (likely (!trust))
+    return false;
+
+  unsigned int length = hb_blob_get_length (blob);
+  if (!length)
+    return false;
+
+  /* Only checksum tables that have an entry of the right length. */
+  hb_lock_t lock (trust->lock);
+  bool have_checksum = false;
+  uint32_t checksum = 0;
+  for (unsigned int i = 0; i < trust->trusted.len; i++)
+  {
+    const hb_face_table_digest_t &digest = trust->trusted[i];
+    if (digest.tag != tag || digest.length != length)
+      continue;
+    if (!have_checksum)
+    {
+      checksum = _hb_face_table_checksum (blob);
+      have_checksum = true;
+    }
+    if (digest.checksum == checksum)
+      return true;
+  }
+  return false;
+}
+
+void
+_hb_face_table_sanitized (const hb_face_t *face, hb_tag_t tag, hb_blob_t *blob)
+{
+  hb_face_trust_t *trust = face->trust;
+  if (likely (!trust))
+    return;
+
+  unsigned int length = hb_blob_get_length (blob);
+  if (!length)
+    return;
+
+  if (trust->keep_sanitized)
+  {
+    hb_lock_t lock (trust->lock);
+    for (unsigned int i = 0; i < trust->sanitized_tables.len; i++)
+      if (trust->sanitized_tables[i].tag == tag)
+	return;
+    hb_face_trust_t::table_t *table = trust->sanitized_tables.push ();
+    if (likely (!trust->sanitized_tables.in_error ()))
+    {
+      table->tag = tag;
+      table->blob = hb_blob_reference (blob);
+    }
+    return;
+  }
+
+  hb_face_table_digest_t digest = {tag, length, _hb_face_table_checksum (blob)};
+
+  hb_lock_t lock (trust->lock);
+  for (unsigned int i = 0; i < trust->sanitized.len; i++)
+    if (0 == memcmp (&trust->sanitized[i], &digest, sizeof (digest)))
+      return;
+  trust->sanitized.push (digest);
+}
+
+hb_blob_t *
+_hb_face_reference_sanitized_table (const hb_face_t *face, hb_tag_t tag)
+{
+  hb_face_trust_t *trust = face->trust;
+  if (likely (!trust) || !trust->keep_sanitized)
+    return nullptr;
+
+  hb_lock_t lock (trust->lock);
+  for (unsigned int i = 0; i < trust->sanitized_tables.len; i++)
+    if (trust->sanitized_tables[i].tag == tag)
+      return hb_blob_reference (trust->sanitized_tables[i].blob);
+  return nullptr;
+}
+
+/* Registers the user data of @face under @key as a cache, such that
+ * hb_face_drop_caches() drops it and hb_face_get_memory_usage() reports it
+ * under @subsystem.  Registering a key again is a no-op. */
+bool
+_hb_face_add_cache (hb_face_t *face,
+		    hb_user_data_key_t *key,
+		    hb_tag_t subsystem,
+		    unsigned int (*get_memory_usage) (void *data))
+{
+  if (unlikely (hb_object_is_inert (face)))
+    return false;
+
+  hb_face_t::cache_node_t *node = nullptr;
+retry:
+  hb_face_t::cache_node_t *caches = face->caches.get ();
+  for (hb_face_t::cache_node_t *cache = caches; cache; cache = cache->next)
+    if (cache->key == key)
+    {
+      free (node);
+      return true;
+    }
+
+  if (!node)
+  {
+    node = (hb_face_t::cache_node_t *) calloc (1, sizeof (hb_face_t::cache_node_t));
+    if (unlikely (!node))
+      return false;
+    node->key = key;
+    node->subsystem = subsystem;
+    node->get_memory_usage = get_memory_usage;
+  }
+  node->next = caches;
+  if (unlikely (!face->caches.cmpexch (caches, node)))
+    goto retry;
+  return true;
+}
+
+/* Makes @face keep the tables that pass sanitization, and hand them out
+ * again instead of sanitizing anew; for faces shared by many short-lived
+ * users, like the subsets of a batch.  Only ever called before @face is
+ * used. */
+bool
+_hb_face_keep_sanitized_tables (hb_face_t *face)
+{
+  if (face->immutable)
+    return false;
+
+  if (!face->trust)
+  {
+    hb_face_trust_t *trust = (hb_face_trust_t *) calloc (1, sizeof (hb_face_trust_t));
+    if (unlikely (!trust))
+      return false;
+    trust->init ();
+    face->trust = trust;
+  }
+
+  face->trust->keep_sanitized = true;
+  return true;
+}
+
+
+/* Address space reserved without backing memory; serializers commit it
+ * as they grow, so that their buffer never moves.  Returns nullptr where
+ * this is not supported. */
+void *
+_hb_memory_reserve (unsigned int size)
+{
+#if defined(HB_RESERVE_MMAP)
+  void *p = mmap (nullptr, size, PROT_NONE,
+		  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  return p == MAP_FAILED ? nullptr : p;
+#elif defined(HB_RESERVE_WIN32)
+  return VirtualAlloc (nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+  return nullptr;
+#endif
+}
+
+/* Makes the first @size bytes of a reservation readable and writable.
+ * @size must be a multiple of HB_MEMORY_COMMIT_SIZE. */
+bool
+_hb_memory_commit (void *p, unsigned int size)
+{
+#if defined(HB_RESERVE_MMAP)
+  return mprotect (p, size, PROT_READ | PROT_WRITE) == 0;
+#elif defined(HB_RESERVE_WIN32)
+  return VirtualAlloc (p, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+  return false;
+#endif
+}
+
+void
+_hb_memory_release (void *p, unsigned int size)
+{
+#if defined(HB_RESERVE_MMAP)
+  munmap (p, size);
+#elif defined(HB_RESERVE_WIN32)
+  VirtualFree (p, 0, MEM_RELEASE);
+#endif
+}
+
 #endif
@@ -29,92 +29,118 @@
 #include "hb-set.h"
 #include "hb-subset-glyf.hh"
 
-static bool
-_calculate_glyf_and_loca_prime_size (const OT::glyf::accelerator_t &glyf,
-                                     hb_vector_t<hb_codepoint_t> &glyph_ids,
-                                     hb_bool_t drop_hints,
-                                     bool *use_short_loca /* OUT */,
-                                     unsigned int *glyf_size /* OUT */,
-                                     unsigned int *loca_size /* OUT */,
-                                     hb_vector_t<unsigned int> *instruction_ranges /* OUT */)
+/*
+ * glyf' is produced in a single pass over the retained glyphs: each glyph is
+ * trimmed, stripped of hints if requested, remapped and appended to a buffer
+ * that grows on demand, while its offset is recorded.  loca' is written from
+ * those offsets once the final size, and thus the loca format, is known.
+ */
+struct glyf_prime_writer_t
 {
-  unsigned int total = 0;
-  for (unsigned int i = 0; i < glyph_ids.len; i++)
+  inline void init (const char *glyf_data_)
   {
-    hb_codepoint_t next_glyph = glyph_ids[i];
-    if (!instruction_ranges->resize (instruction_ranges->len + 2))
-    {
-      DEBUG_MSG(SUBSET, nullptr, "Failed to resize instruction_ranges.");
-      return false;
-    }
-    unsigned int *instruction_start = &(*instruction_ranges)[instruction_ranges->len - 2];
-    *instruction_start = 0;
-    unsigned int *instruction_end = &(*instruction_ranges)[instruction_ranges->len - 1];
-    *instruction_end = 0;
+    glyf_data = glyf_data_;
+    data = nullptr;
+    length = allocated = 0;
+    run_start = run_length = 0;
+  }
 
-    unsigned int start_offset, end_offset;
-    if (unlikely (!(glyf.get_offsets(next_glyph, &start_offset, &end_offset)
-                    && glyf.remove_padding(start_offset, &end_offset))))
-    {
-      DEBUG_MSG(SUBSET, nullptr, "Invalid gid %d", next_glyph);
-      continue;
-    }
-    if (end_offset - start_offset < OT::glyf::GlyphHeader::static_size)
-      continue; /* 0-length glyph */
+  inline void fini (void)
+  {
+    free (data);
+    data = nullptr;
+  }
 
-    if (drop_hints)
+  inline bool alloc (unsigned int size)
+  {
+    if (likely (size <= allocated))
+      return true;
+
+    unsigned int new_allocated = allocated;
+    while (new_allocated < size)
     {
-      if (unlikely (!glyf.get_instruction_offsets(start_offset, end_offset,
-                                                  instruction_start, instruction_end)))
+      if (unlikely (new_allocated >= ((unsigned int) -1) / 2))
       {
-        DEBUG_MSG(SUBSET, nullptr, "Unable to get instruction offsets for %d", next_glyph);
-        return false;
+        new_allocated = size;
+        break;
       }
+      new_allocated += (new_allocated >> 1) + 1024;
     }
 
-    total += end_offset - start_offset - (*instruction_end - *instruction_start);
-    /* round2 so short loca will work */
-    total += total % 2;
+    char *new_data = (char *) realloc (data, new_allocated);
+    if (unlikely (!new_data))
+      return false;
+    data = new_data;
+    allocated = new_allocated;
+    return true;
   }
 
-  *glyf_size = total;
-  *use_short_loca = (total <= 131070);
-  *loca_size = (glyph_ids.len + 1)
-      * (*use_short_loca ? sizeof(OT::HBUINT16) : sizeof(OT::HBUINT32));
+  /* Gives back whatever the estimate in alloc() overshot. */
+  inline void shrink (void)
+  {
+    if (length >= allocated)
+      return;
+    char *new_data = (char *) realloc (data, MAX (length, 1u));
+    if (likely (new_data))
+    {
+      data = new_data;
+      allocated = MAX (length, 1u);
+    }
+  }
 
-  DEBUG_MSG(SUBSET, nullptr, "preparing to subset glyf: final size %d, loca size %d, using %s loca",
-            total,
-            *loca_size,
-            *use_short_loca ? "short" : "long");
-  return true;
-}
+  /* Returns the start of room for size bytes at the end of the output;
+   * the pending run of unmodified source bytes is flushed first. */
+  inline char *push (unsigned int size)
+  {
+    if (unlikely (!flush () ||
+                  length + size < length ||
+                  !alloc (length + size)))
+      return nullptr;
+    char *ret = data + length;
+    length += size;
+    return ret;
+  }
 
-static bool
-_write_loca_entry (unsigned int  id,
-                   unsigned int  offset,
-                   bool          is_short,
-                   void         *loca_prime,
-                   unsigned int  loca_size)
-{
-  unsigned int entry_size = is_short ? sizeof (OT::HBUINT16) : sizeof (OT::HBUINT32);
-  if ((id + 1) * entry_size <= loca_size)
+  /* Glyphs that are emitted unmodified and sit back to back in the source
+   * are collected into a run and copied with a single memcpy. */
+  inline bool copy (unsigned int start_offset, unsigned int size)
   {
-    if (is_short) {
-      ((OT::HBUINT16*) loca_prime) [id].set (offset / 2);
-    } else {
-      ((OT::HBUINT32*) loca_prime) [id].set (offset);
+    if (run_length && run_start + run_length == start_offset)
+    {
+      run_length += size;
+      return true;
     }
+    if (unlikely (!flush ()))
+      return false;
+    run_start = start_offset;
+    run_length = size;
     return true;
   }
 
-  // Offset was not written because the write is out of bounds.
-  DEBUG_MSG (SUBSET,
-             nullptr,
-             "WARNING: Attempted to write an out of bounds loca entry at index %d. Loca size is %d.",
-             id,
-             loca_size);
-  return false;
-}
+  inline bool flush (void)
+  {
+    if (!run_length)
+      return true;
+    unsigned int size = run_length;
+    run_length = 0;
+    char *dest = push (size);
+    if (unlikely (!dest))
+      return false;
+    memcpy (dest, glyf_data + run_start, size);
+    return true;
+  }
+
+  /* Current output offset, including the pending run. */
+  inline unsigned int tell (void) const
+  { return length + run_length; }
+
+  const char *glyf_data;
+  char *data;
+  unsigned int length;
+  unsigned int allocated;
+  unsigned int run_start;
+  unsigned int run_length;
+};
 
 static void
 _update_components (hb_subset_plan_t * plan,
@@ -153,117 +179,166 @@ static bool _remove_composite_instruction_flag(char *glyf_prime, unsigned int le
 }
 
 static bool
-_write_glyf_and_loca_prime (hb_subset_plan_t              *plan,
-			    const OT::glyf::accelerator_t &glyf,
-                            const char                    *glyf_data,
-                            bool                           use_short_loca,
-                            hb_vector_t<unsigned int> &instruction_ranges,
-                            unsigned int                   glyf_prime_size,
-                            char                          *glyf_prime_data /* OUT */,
-                            unsigned int                   loca_prime_size,
-                            char                          *loca_prime_data /* OUT */)
+_write_glyf_prime (hb_subset_plan_t              *plan,
+                   const OT::glyf::accelerator_t &glyf,
+                   const char                    *glyf_data,
+                   unsigned int                   glyf_data_length,
+                   glyf_prime_writer_t           *writer,
+                   hb_vector_t<unsigned int>     *offsets /* OUT */)
 {
   hb_vector_t<hb_codepoint_t> &glyph_ids = plan->glyphs;
-  char *glyf_prime_data_next = glyf_prime_data;
 
-  bool success = true;
+  /* Start from the retained share of the source table, plus a byte of
+   * padding per glyph; push() grows the buffer should that fall short. */
+  unsigned int estimate = glyf_data_length;
+  unsigned int num_glyphs = plan->source->get_num_glyphs ();
+  if (num_glyphs > glyph_ids.len)
+    estimate = (uint64_t) glyf_data_length * glyph_ids.len / num_glyphs;
+  if (unlikely (!writer->alloc (MIN (estimate, ((unsigned int) -1) - glyph_ids.len) + glyph_ids.len) ||
+                !offsets->resize (glyph_ids.len + 1)))
+    return false;
+
   for (unsigned int i = 0; i < glyph_ids.len; i++)
   {
+    (*offsets)[i] = writer->tell ();
+
     unsigned int start_offset, end_offset;
     if (unlikely (!(glyf.get_offsets (glyph_ids[i], &start_offset, &end_offset)
-                    && glyf.remove_padding(start_offset, &end_offset))))
-      end_offset = start_offset = 0;
+                    && glyf.remove_padding (start_offset, &end_offset))))
+    {
+      DEBUG_MSG(SUBSET, nullptr, "Invalid gid %d", glyph_ids[i]);
+      continue;
+    }
 
-    unsigned int instruction_start = instruction_ranges[i * 2];
-    unsigned int instruction_end = instruction_ranges[i * 2 + 1];
+    unsigned int instruction_start = 0, instruction_end = 0;
+    unsigned int length = end_offset - start_offset;
+    bool is_composite = false;
+    if (length >= OT::glyf::GlyphHeader::static_size)
+    {
+      is_composite = (int16_t) StructAtOffset<OT::glyf::GlyphHeader> (glyf_data, start_offset).numberOfContours < 0;
+      if (plan->drop_hints &&
+          unlikely (!glyf.get_instruction_offsets (start_offset, end_offset,
+                                                   &instruction_start, &instruction_end)))
+      {
+        DEBUG_MSG(SUBSET, nullptr, "Unable to get instruction offsets for %d", glyph_ids[i]);
+        return false;
+      }
+      length -= instruction_end - instruction_start;
+    }
+    /* round2 so short loca will work */
+    unsigned int padded_length = length + (length % 2);
 
-    int length = end_offset - start_offset - (instruction_end - instruction_start);
+    if (!is_composite && instruction_start == instruction_end)
+    {
+      /* Unmodified glyph; the source bytes can be reused as-is, padding
+       * included, as long as the source pads with zero as well. */
+      if (length == padded_length ||
+          (end_offset < glyf_data_length && glyf_data[end_offset] == 0))
+      {
+        if (unlikely (!writer->copy (start_offset, length) ||
+                      !writer->copy (end_offset, padded_length - length)))
+          return false;
+        continue;
+      }
+    }
 
-    if (glyf_prime_data_next + length > glyf_prime_data + glyf_prime_size)
+    char *dest = writer->push (padded_length);
+    if (unlikely (!dest))
     {
-      DEBUG_MSG (SUBSET,
-                 nullptr,
-                 "WARNING: Attempted to write an out of bounds glyph entry for gid %d (length %d)",
-                 i, length);
+      DEBUG_MSG (SUBSET, nullptr, "Failed to grow glyf' for gid %d (length %d)", i, length);
       return false;
     }
+    dest[padded_length - 1] = 0;
 
     if (instruction_start == instruction_end)
-      memcpy (glyf_prime_data_next, glyf_data + start_offset, length);
+      memcpy (dest, glyf_data + start_offset, length);
     else
     {
-      memcpy (glyf_prime_data_next, glyf_data + start_offset, instruction_start - start_offset);
-      memcpy (glyf_prime_data_next + instruction_start - start_offset, glyf_data + instruction_end, end_offset - instruction_end);
+      memcpy (dest, glyf_data + start_offset, instruction_start - start_offset);
+      memcpy (dest + instruction_start - start_offset, glyf_data + instruction_end, end_offset - instruction_end);
       /* if the instructions end at the end this was a composite glyph, else simple */
       if (instruction_end == end_offset)
       {
-        if (unlikely (!_remove_composite_instruction_flag (glyf_prime_data_next, length))) return false;
+        if (unlikely (!_remove_composite_instruction_flag (dest, length))) return false;
       }
       else
         /* zero instruction length, which is just before instruction_start */
-        memset (glyf_prime_data_next + instruction_start - start_offset - 2, 0, 2);
+        memset (dest + instruction_start - start_offset - 2, 0, 2);
     }
 
-    success = success && _write_loca_entry (i,
-                                            glyf_prime_data_next - glyf_prime_data,
-                                            use_short_loca,
-                                            loca_prime_data,
-                                            loca_prime_size);
-    _update_components (plan, glyf_prime_data_next, length);
-
-    // TODO: don't align to two bytes if using long loca.
-    glyf_prime_data_next += length + (length % 2); // Align to 2 bytes for short loca.
+    if (is_composite)
+      _update_components (plan, dest, length);
   }
 
-  success = success && _write_loca_entry (glyph_ids.len,
-                                          glyf_prime_data_next - glyf_prime_data,
-                                          use_short_loca,
-                                          loca_prime_data,
-                                          loca_prime_size);
-  return success;
+  if (unlikely (!writer->flush ()))
+    return false;
+  (*offsets)[glyph_ids.len] = writer->tell ();
+  return true;
+}
+
+static char *
+_write_loca_prime (const hb_vector_t<unsigned int> &offsets,
+                   bool                             use_short_loca,
+                   unsigned int                    *loca_prime_size /* OUT */)
+{
+  unsigned int entry_size = use_short_loca ? sizeof (OT::HBUINT16) : sizeof (OT::HBUINT32);
+  *loca_prime_size = offsets.len * entry_size;
+  char *loca_prime_data = (char *) malloc (*loca_prime_size);
+  if (unlikely (!loca_prime_data))
+    return nullptr;
+
+  if (use_short_loca)
+    for (unsigned int i = 0; i < offsets.len; i++)
+      ((OT::HBUINT16 *) loca_prime_data)[i].set (offsets[i] / 2);
+  else
+    for (unsigned int i = 0; i < offsets.len; i++)
+      ((OT::HBUINT32 *) loca_prime_data)[i].set (offsets[i]);
+
+  return loca_prime_data;
 }
 
 static bool
 _hb_subset_glyf_and_loca (const OT::glyf::accelerator_t  &glyf,
                           const char                     *glyf_data,
+                          unsigned int                    glyf_data_length,
                           hb_subset_plan_t               *plan,
                           bool                           *use_short_loca,
                           hb_blob_t                     **glyf_prime /* OUT */,
                           hb_blob_t                     **loca_prime /* OUT */)
 {
-  // TODO(grieger): Sanity check allocation size for the new table.
-  hb_vector_t<hb_codepoint_t> &glyphs_to_retain = plan->glyphs;
+  glyf_prime_writer_t writer;
+  writer.init (glyf_data);
+  hb_vector_t<unsigned int> offsets;
+  offsets.init ();
 
-  unsigned int glyf_prime_size;
-  unsigned int loca_prime_size;
-  hb_vector_t<unsigned int> instruction_ranges;
-  instruction_ranges.init();
-
-  if (unlikely (!_calculate_glyf_and_loca_prime_size (glyf,
-                                                      glyphs_to_retain,
-                                                      plan->drop_hints,
-                                                      use_short_loca,
-                                                      &glyf_prime_size,
-                                                      &loca_prime_size,
-                                                      &instruction_ranges))) {
-    instruction_ranges.fini();
+  if (unlikely (!_write_glyf_prime (plan, glyf, glyf_data, glyf_data_length,
+                                    &writer, &offsets)))
+  {
+    writer.fini ();
+    offsets.fini ();
     return false;
   }
 
-  char *glyf_prime_data = (char *) calloc (1, glyf_prime_size);
-  char *loca_prime_data = (char *) calloc (1, loca_prime_size);
-  if (unlikely (!_write_glyf_and_loca_prime (plan, glyf, glyf_data,
-                                             *use_short_loca,
-                                             instruction_ranges,
-                                             glyf_prime_size, glyf_prime_data,
-                                             loca_prime_size, loca_prime_data))) {
-    free (glyf_prime_data);
-    free (loca_prime_data);
-    instruction_ranges.fini();
+  unsigned int glyf_prime_size = writer.length;
+  *use_short_loca = (glyf_prime_size <= 131070);
+  unsigned int loca_prime_size;
+  char *loca_prime_data = _write_loca_prime (offsets, *use_short_loca, &loca_prime_size);
+  offsets.fini ();
+  if (unlikely (!loca_prime_data))
+  {
+    writer.fini ();
     return false;
   }
-  instruction_ranges.fini();
 
+  DEBUG_MSG(SUBSET, nullptr, "subset glyf: final size %d, loca size %d, using %s loca",
+            glyf_prime_size,
+            loca_prime_size,
+            *use_short_loca ? "short" : "long");
+
+  /* The blob takes over the buffer, trimmed to its contents first. */
+  writer.shrink ();
+  char *glyf_prime_data = writer.data;
+  writer.data = nullptr;
   *glyf_prime = hb_blob_create (glyf_prime_data,
                                 glyf_prime_size,
                                 HB_MEMORY_MODE_READONLY,
@@ -292,12 +367,14 @@ hb_subset_glyf_and_loca (hb_subset_plan_t *plan,
                          hb_blob_t       **loca_prime /* OUT */)
 {
   hb_blob_t *glyf_blob = hb_sanitize_context_t ().reference_table<OT::glyf> (plan->source);
-  const char *glyf_data = hb_blob_get_data(glyf_blob, nullptr);
+  unsigned int glyf_data_length;
+  const char *glyf_data = hb_blob_get_data(glyf_blob, &glyf_data_length);
 
   OT::glyf::accelerator_t glyf;
   glyf.init(plan->source);
   bool result = _hb_subset_glyf_and_loca (glyf,
                                           glyf_data,
+                                          glyf_data_length,
                                           plan,
                                           use_short_loca,
                                           glyf_prime,
@@ -27,44 +27,269 @@
 #include "hb-subset-plan.hh"
 #include "hb-map.hh"
 #include "hb-set.hh"
+#include "hb-mutex.hh"
 
 #include "hb-ot-cmap-table.hh"
 #include "hb-ot-glyf-table.hh"
 
-static void
-_add_gid_and_children (const OT::glyf::accelerator_t &glyf,
-		       hb_codepoint_t gid,
-		       hb_set_t *gids_to_retain)
+/*
+ * Closure cache.
+ *
+ * Servers tend to subset the same face over and over; what only depends
+ * on the face is kept on it, and shared by all plans for that face.  GSUB
+ * closure does not distribute over union (think ligatures), so it is only
+ * reused for repeated glyph sets; the composite glyph closure does, and is
+ * cached per glyph.
+ */
+
+/* GSUB closures to keep, most recently used first. */
+#define HB_SUBSET_CLOSURE_CACHE_GSUB_ENTRIES 8
+
+struct hb_subset_closure_cache_t
 {
-  if (hb_set_has (gids_to_retain, gid))
-    // Already visited this gid, ignore.
-    return;
+  struct gsub_entry_t
+  {
+    hb_set_t *glyphs;
+    hb_set_t *closure;
+  };
+
+  hb_mutex_t lock;
 
-  hb_set_add (gids_to_retain, gid);
+  OT::cmap::accelerator_t cmap;
+  OT::glyf::accelerator_t glyf;
 
-  OT::glyf::CompositeGlyphHeader::Iterator composite;
-  if (glyf.get_composite (gid, &composite))
+  /* For each glyph visited, index into components of its transitive
+   * components, terminated by HB_MAP_VALUE_INVALID. */
+  hb_map_t components_start;
+  hb_vector_t<hb_codepoint_t> components;
+
+  hb_vector_t<gsub_entry_t> gsub_closures;
+
+  inline void init (hb_face_t *face)
+  {
+    lock.init ();
+    cmap.init (face);
+    glyf.init (face);
+    components_start.init ();
+    components.init ();
+    components.push (HB_MAP_VALUE_INVALID); /* Shared by simple glyphs. */
+    gsub_closures.init ();
+  }
+
+  inline void fini (void)
   {
-    do
+    for (unsigned int i = 0; i < gsub_closures.len; i++)
     {
-      _add_gid_and_children (glyf, (hb_codepoint_t) composite.current->glyphIndex, gids_to_retain);
-    } while (composite.move_to_next());
+      hb_set_destroy (gsub_closures[i].glyphs);
+      hb_set_destroy (gsub_closures[i].closure);
+    }
+    gsub_closures.fini ();
+    components.fini ();
+    components_start.fini ();
+    glyf.fini ();
+    cmap.fini ();
+    lock.fini ();
+  }
+
+  inline unsigned int get_memory_usage (void)
+  {
+    hb_lock_t l (lock);
+    unsigned int usage = sizeof (*this) +
+			 components_start.get_memory_usage () +
+			 components.get_memory_usage () +
+			 gsub_closures.get_memory_usage ();
+    for (unsigned int i = 0; i < gsub_closures.len; i++)
+      usage += 2 * sizeof (hb_set_t) +
+	       gsub_closures[i].glyphs->get_memory_usage () +
+	       gsub_closures[i].closure->get_memory_usage ();
+    return usage;
+  }
+
+  /* The lock is only held to look components up and to cache them;
+   * composite glyphs are walked without it. */
+  inline void add_gid_and_children (hb_codepoint_t gid, hb_set_t *gids_to_retain)
+  {
+    if (hb_set_has (gids_to_retain, gid))
+      // Already visited this gid, ignore.
+      return;
+
+    hb_set_add (gids_to_retain, gid);
+
+    if (get_components (gid, gids_to_retain))
+      return;
+
+    hb_auto_t<hb_set_t> children;
+    OT::glyf::CompositeGlyphHeader::Iterator composite;
+    if (glyf.get_composite (gid, &composite))
+    {
+      children.add (gid);
+      do
+      {
+	collect_children (composite.current->glyphIndex, &children);
+      } while (composite.move_to_next());
+      children.del (gid);
+    }
+
+    gids_to_retain->union_ (&children);
+    set_components (gid, &children);
+  }
+
+  /* Adds the cached components of gid to gids_to_retain; returns false if
+   * there are none cached. */
+  inline bool get_components (hb_codepoint_t gid, hb_set_t *gids_to_retain)
+  {
+    hb_lock_t l (lock);
+    unsigned int start = components_start.get (gid);
+    if (start == HB_MAP_VALUE_INVALID)
+      return false;
+    for (unsigned int i = start; components[i] != HB_MAP_VALUE_INVALID; i++)
+      gids_to_retain->add (components[i]);
+    return true;
+  }
+
+  inline void set_components (hb_codepoint_t gid, const hb_set_t *children)
+  {
+    hb_lock_t l (lock);
+    if (components_start.get (gid) != HB_MAP_VALUE_INVALID)
+      return; /* Cached by another thread meanwhile. */
+
+    unsigned int start = 0;
+    if (!children->is_empty ())
+    {
+      start = components.len;
+      for (hb_codepoint_t child = HB_SET_VALUE_INVALID; children->next (&child);)
+	components.push (child);
+      components.push (HB_MAP_VALUE_INVALID);
+      if (unlikely (components.in_error ()))
+	return; /* Stays uncached. */
+    }
+    components_start.set (gid, start);
   }
-}
+
+  inline void collect_children (hb_codepoint_t gid, hb_set_t *children) const
+  {
+    if (children->has (gid))
+      return;
+
+    children->add (gid);
+
+    OT::glyf::CompositeGlyphHeader::Iterator composite;
+    if (glyf.get_composite (gid, &composite))
+    {
+      do
+      {
+	collect_children (composite.current->glyphIndex, children);
+      } while (composite.move_to_next());
+    }
+  }
+
+  inline void gsub_closure (hb_face_t *face, hb_set_t *gids_to_retain)
+  {
+    lock.lock ();
+    for (unsigned int i = 0; i < gsub_closures.len; i++)
+      if (gsub_closures[i].glyphs->is_equal (gids_to_retain))
+      {
+	gsub_entry_t entry = gsub_closures[i];
+	memmove (&gsub_closures[1], &gsub_closures[0], i * sizeof (entry));
+	gsub_closures[0] = entry;
+	gids_to_retain->set (entry.closure);
+	lock.unlock ();
+	return;
+      }
+    lock.unlock ();
+
+    gsub_entry_t entry = {hb_set_create (), hb_set_create ()};
+    entry.glyphs->set (gids_to_retain);
+    _gsub_closure (face, gids_to_retain);
+    entry.closure->set (gids_to_retain);
+    if (unlikely (!entry.glyphs->successful || !entry.closure->successful))
+    {
+      hb_set_destroy (entry.glyphs);
+      hb_set_destroy (entry.closure);
+      return;
+    }
+
+    lock.lock ();
+    if (gsub_closures.len < HB_SUBSET_CLOSURE_CACHE_GSUB_ENTRIES)
+      gsub_closures.push (entry);
+    if (unlikely (gsub_closures.in_error ()))
+    {
+      lock.unlock ();
+      hb_set_destroy (entry.glyphs);
+      hb_set_destroy (entry.closure);
+      return;
+    }
+    gsub_entry_t evicted = gsub_closures[gsub_closures.len - 1];
+    memmove (&gsub_closures[1], &gsub_closures[0], (gsub_closures.len - 1) * sizeof (entry));
+    gsub_closures[0] = entry;
+    lock.unlock ();
+
+    if (evicted.glyphs != entry.glyphs)
+    {
+      hb_set_destroy (evicted.glyphs);
+      hb_set_destroy (evicted.closure);
+    }
+  }
+
+  static void _gsub_closure (hb_face_t *face, hb_set_t *gids_to_retain)
+  {
+    hb_auto_t<hb_set_t> lookup_indices;
+    hb_ot_layout_collect_lookups (face,
+				  HB_OT_TAG_GSUB,
+				  nullptr,
+				  nullptr,
+				  nullptr,
+				  &lookup_indices);
+    hb_ot_layout_lookups_substitute_closure (face,
+					     &lookup_indices,
+					     gids_to_retain);
+  }
+};
 
 static void
-_gsub_closure (hb_face_t *face, hb_set_t *gids_to_retain)
+_hb_subset_closure_cache_destroy (void *data)
+{
+  hb_subset_closure_cache_t *cache = (hb_subset_closure_cache_t *) data;
+  cache->fini ();
+  free (cache);
+}
+
+static unsigned int
+_hb_subset_closure_cache_get_memory_usage (void *data)
 {
-  hb_auto_t<hb_set_t> lookup_indices;
-  hb_ot_layout_collect_lookups (face,
-                                HB_OT_TAG_GSUB,
-                                nullptr,
-                                nullptr,
-                                nullptr,
-                                &lookup_indices);
-  hb_ot_layout_lookups_substitute_closure (face,
-                                           &lookup_indices,
-                                           gids_to_retain);
+  return ((hb_subset_closure_cache_t *) data)->get_memory_usage ();
+}
+
+static hb_user_data_key_t _hb_subset_closure_cache_key;
+
+/* Returns nullptr if the face cannot hold one. */
+static hb_subset_closure_cache_t *
+_get_closure_cache (hb_face_t *face)
+{
+  hb_subset_closure_cache_t *cache = (hb_subset_closure_cache_t *)
+    hb_face_get_user_data (face, &_hb_subset_closure_cache_key);
+  if (likely (cache))
+    return cache;
+
+  cache = (hb_subset_closure_cache_t *) calloc (1, sizeof (hb_subset_closure_cache_t));
+  if (unlikely (!cache))
+    return nullptr;
+  cache->init (face);
+
+  if (unlikely (!hb_face_set_user_data (face, &_hb_subset_closure_cache_key,
+					cache, _hb_subset_closure_cache_destroy,
+					false)))
+  {
+    /* Lost a race to another thread, or face is immutable. */
+    _hb_subset_closure_cache_destroy (cache);
+    return (hb_subset_closure_cache_t *)
+      hb_face_get_user_data (face, &_hb_subset_closure_cache_key);
+  }
+
+  _hb_face_add_cache (face, &_hb_subset_closure_cache_key,
+		      HB_MEMORY_USAGE_SUBSET_CLOSURES,
+		      _hb_subset_closure_cache_get_memory_usage);
+  return cache;
 }
 
 
@@ -76,10 +301,13 @@ _populate_gids_to_retain (hb_face_t *face,
                           hb_map_t *codepoint_to_glyph,
                           hb_vector_t<hb_codepoint_t> *glyphs)
 {
-  OT::cmap::accelerator_t cmap;
-  OT::glyf::accelerator_t glyf;
-  cmap.init (face);
-  glyf.init (face);
+  hb_subset_closure_cache_t local_cache;
+  hb_subset_closure_cache_t *cache = _get_closure_cache (face);
+  if (unlikely (!cache))
+  {
+    local_cache.init (face);
+    cache = &local_cache;
+  }
 
   hb_set_t *initial_gids_to_retain = hb_set_create ();
   initial_gids_to_retain->add (0); // Not-def
@@ -88,7 +316,7 @@ _populate_gids_to_retain (hb_face_t *face,
   while (unicodes->next (&cp))
   {
     hb_codepoint_t gid;
-    if (!cmap.get_nominal_glyph (cp, &gid))
+    if (!cache->cmap.get_nominal_glyph (cp, &gid))
     {
       DEBUG_MSG(SUBSET, nullptr, "Drop U+%04X; no gid", cp);
       continue;
@@ -100,7 +328,7 @@ _populate_gids_to_retain (hb_face_t *face,
 
   if (close_over_gsub)
     // Add all glyphs needed for GSUB substitutions.
-    _gsub_closure (face, initial_gids_to_retain);
+    cache->gsub_closure (face, initial_gids_to_retain);
 
   // Populate a full set of glyphs to retain by adding all referenced
   // composite glyphs.
@@ -108,7 +336,7 @@ _populate_gids_to_retain (hb_face_t *face,
   hb_set_t *all_gids_to_retain = hb_set_create ();
   while (initial_gids_to_retain->next (&gid))
   {
-    _add_gid_and_children (glyf, gid, all_gids_to_retain);
+    cache->add_gid_and_children (gid, all_gids_to_retain);
   }
   hb_set_destroy (initial_gids_to_retain);
 
@@ -117,8 +345,8 @@ _populate_gids_to_retain (hb_face_t *face,
   while (all_gids_to_retain->next (&gid))
     glyphs->push (gid);
 
-  glyf.fini ();
-  cmap.fini ();
+  if (cache == &local_cache)
+    local_cache.fini ();
 
   return all_gids_to_retain;
 }
@@ -154,6 +382,7 @@ hb_subset_plan_create (hb_face_t           *face,
   plan->glyphs.init();
   plan->source = hb_face_reference (face);
   plan->dest = hb_face_builder_create ();
+  plan->tasks = nullptr;
   plan->codepoint_to_glyph = hb_map_create();
   plan->glyph_map = hb_map_create();
   plan->glyphset = _populate_gids_to_retain (face,
@@ -55,6 +55,39 @@ struct hb_subset_plan_t
   hb_face_t *source;
   hb_face_t *dest;
 
+  struct staged_table_t
+  {
+    hb_tag_t tag;
+    hb_blob_t *blob;
+  };
+
+  // Subsetting one source table, and the tables it produced.
+  struct task_t
+  {
+    hb_tag_t tag;
+    bool success;
+    hb_vector_t<staged_table_t> tables;
+  };
+
+  // If set, tables are collected in the task producing them instead of
+  // being added to dest; used to subset tables concurrently and add them
+  // to dest in order later.  Each task only ever touches its own tables.
+  hb_vector_t<task_t> *tasks;
+
+  // The source table whose subsetting produces the table tagged tag; those
+  // tables are skipped by hb_subset_table().
+  static inline hb_tag_t
+  producer_of (hb_tag_t tag)
+  {
+    switch (tag) {
+      case HB_TAG ('h','e','a','d'):
+      case HB_TAG ('l','o','c','a'): return HB_TAG ('g','l','y','f');
+      case HB_TAG ('h','h','e','a'): return HB_TAG ('h','m','t','x');
+      case HB_TAG ('v','h','e','a'): return HB_TAG ('v','m','t','x');
+      default: return tag;
+    }
+  }
+
   inline bool
   new_gid_for_codepoint (hb_codepoint_t codepoint,
                          hb_codepoint_t *new_gid) const
@@ -88,6 +121,25 @@ struct hb_subset_plan_t
               hb_blob_get_length (contents),
               hb_blob_get_length (source_blob));
     hb_blob_destroy (source_blob);
+
+    if (tasks)
+    {
+      hb_tag_t producer = producer_of (tag);
+      for (unsigned int i = 0; i < tasks->len; i++)
+      {
+        task_t &task = (*tasks)[i];
+        if (task.tag != producer)
+          continue;
+        staged_table_t *table = task.tables.push ();
+        if (unlikely (task.tables.in_error ()))
+          return false;
+        table->tag = tag;
+        table->blob = hb_blob_reference (contents);
+        return true;
+      }
+      return false;
+    }
+
     return hb_face_builder_add_table (dest, tag, contents);
   }
 };
@@ -0,0 +1,865 @@
+/*
+ * Copyright © 2026  Google, Inc.
+ *
+ *  This is part of HarfBuzz, a text shaping library.
+ *
+ * Permission is hereby granted, without written agreement and without
+ * license or royalty fees, to use, copy, modify, and distribute this
+ * software and its documentation for any purpose, provided that the
+ * above copyright notice and the following two paragraphs appear in
+ * all copies of this software.
+ *
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES
+ * ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN
+ * IF THE COPYRIGHT HOLDER HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * THE COPYRIGHT HOLDER SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING,
+ * BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE COPYRIGHT HOLDER HAS NO OBLIGATION TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ */
+
+#include "hb-subset-woff.hh"
+
+#include "hb-open-file.hh"
+#include "hb-ot-glyf-table.hh"
+#include "hb-ot-head-table.hh"
+#include "hb-vector.hh"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+
+
+namespace OT {
+
+/*
+ * WOFF -- Web Open Font Format
+ * https://www.w3.org/TR/WOFF/
+ */
+
+struct WOFFHeader
+{
+  Tag		signature;	/* 0x774F4646 'wOFF' */
+  Tag		flavor;		/* The sfntVersion of the font. */
+  HBUINT32	length;		/* Total size of the WOFF file. */
+  HBUINT16	numTables;	/* Number of entries in the table directory. */
+  HBUINT16	reserved;	/* Set to 0. */
+  HBUINT32	totalSfntSize;	/* Total size of the uncompressed font,
+				 * including header, directory and padding. */
+  HBUINT16	majorVersion;	/* Major version of the WOFF file. */
+  HBUINT16	minorVersion;	/* Minor version of the WOFF file. */
+  HBUINT32	metaOffset;	/* Offset to metadata block. */
+  HBUINT32	metaLength;	/* Length of compressed metadata block. */
+  HBUINT32	metaOrigLength;	/* Uncompressed size of metadata block. */
+  HBUINT32	privOffset;	/* Offset to private data block. */
+  HBUINT32	privLength;	/* Length of private data block. */
+  public:
+  DEFINE_SIZE_STATIC (44);
+};
+
+struct WOFFTableDirectoryEntry
+{
+  Tag		tag;		/* 4-byte sfnt table identifier. */
+  HBUINT32	offset;		/* Offset to the data, from beginning of
+				 * WOFF file. */
+  HBUINT32	compLength;	/* Length of the compressed data. */
+  HBUINT32	origLength;	/* Length of the uncompressed table. */
+  CheckSum	origChecksum;	/* Checksum of the uncompressed table. */
+  public:
+  DEFINE_SIZE_STATIC (20);
+};
+
+
+/*
+ * WOFF2 -- Web Open Font Format 2
+ * https://www.w3.org/TR/WOFF2/
+ */
+
+struct WOFF2Header
+{
+  Tag		signature;	/* 0x774F4632 'wOF2' */
+  Tag		flavor;		/* The sfntVersion of the font. */
+  HBUINT32	length;		/* Total size of the WOFF2 file. */
+  HBUINT16	numTables;	/* Number of entries in the table directory. */
+  HBUINT16	reserved;	/* Set to 0. */
+  HBUINT32	totalSfntSize;	/* Total size of the uncompressed font,
+				 * including header, directory and padding. */
+  HBUINT32	totalCompressedSize;
+				/* Size of the compressed data stream. */
+  HBUINT16	majorVersion;	/* Major version of the WOFF2 file. */
+  HBUINT16	minorVersion;	/* Minor version of the WOFF2 file. */
+  HBUINT32	metaOffset;	/* Offset to metadata block. */
+  HBUINT32	metaLength;	/* Length of compressed metadata block. */
+  HBUINT32	metaOrigLength;	/* Uncompressed size of metadata block. */
+  HBUINT32	privOffset;	/* Offset to private data block. */
+  HBUINT32	privLength;	/* Length of private data block. */
+  public:
+  DEFINE_SIZE_STATIC (48);
+};
+
+struct WOFF2TransformedGlyfHeader
+{
+  HBUINT16	reserved;	/* Set to 0. */
+  HBUINT16	optionFlags;	/* Bit 0: overlapSimpleBitmap present. */
+  HBUINT16	numGlyphs;	/* Number of glyphs. */
+  HBUINT16	indexFormat;	/* Offset format for loca table. */
+  HBUINT32	nContourStreamSize;
+  HBUINT32	nPointsStreamSize;
+  HBUINT32	flagStreamSize;
+  HBUINT32	glyphStreamSize;
+  HBUINT32	compositeStreamSize;
+  HBUINT32	bboxStreamSize;
+  HBUINT32	instructionStreamSize;
+  public:
+  DEFINE_SIZE_STATIC (36);
+};
+
+} /* namespace OT */
+
+
+/*
+ * The tables of a face, in tag order, with their checksums in the sfnt
+ * font that hb_face_builder_write() would write.  The head table is
+ * replaced with a copy that has its checkSumAdjustment set.
+ */
+
+struct hb_woff_table_t
+{
+  hb_tag_t   tag;
+  hb_blob_t *blob;
+  uint32_t   checksum;
+
+  static int cmp (const void *pa, const void *pb)
+  {
+    const hb_woff_table_t *a = (const hb_woff_table_t *) pa;
+    const hb_woff_table_t *b = (const hb_woff_table_t *) pb;
+    return a->tag < b->tag ? -1 : a->tag > b->tag ? 1 : 0;
+  }
+};
+
+struct hb_woff_source_t
+{
+  inline bool init (hb_face_t *face)
+  {
+    tables.init ();
+    flavor = OT::OpenTypeFontFile::TrueTypeTag;
+    sfnt_size = 0;
+
+    unsigned int table_count = hb_face_get_table_tags (face, 0, nullptr, nullptr);
+    hb_auto_t<hb_vector_t<hb_tag_t> > tags;
+    if (unlikely (!table_count || !tags.resize (table_count) || !tables.resize (table_count)))
+    {
+      tables.resize (0);
+      return false;
+    }
+    hb_face_get_table_tags (face, 0, &table_count, tags.arrayZ ());
+    for (unsigned int i = 0; i < table_count; i++)
+    {
+      tables[i].tag = tags[i];
+      tables[i].blob = hb_face_reference_table (face, tags[i]);
+      tables[i].checksum = 0;
+      if (tags[i] == HB_TAG ('C','F','F',' ') || tags[i] == HB_TAG ('C','F','F','2'))
+	flavor = OT::OpenTypeFontFile::CFFTag;
+    }
+    tables.qsort (hb_woff_table_t::cmp);
+
+    /* Tag zero cannot be looked up as a table, and WOFF directories
+     * cannot hold the same tag twice. */
+    for (unsigned int i = 0; i < table_count; i++)
+      if (unlikely (!tables[i].tag || (i && tables[i].tag == tables[i - 1].tag)))
+	return false;
+
+    unsigned int dir_length = table_count * 16 + 12;
+    char *dir = (char *) malloc (dir_length);
+    if (unlikely (!dir))
+      return false;
+
+    hb_serialize_context_t c (dir, dir_length);
+    OT::OpenTypeFontFile *f = c.start_serialize<OT::OpenTypeFontFile> ();
+    Supplier<hb_tag_t>    tags_supplier  (&tables[0].tag, table_count, sizeof (tables[0]));
+    Supplier<hb_blob_t *> blobs_supplier (&tables[0].blob, table_count, sizeof (tables[0]));
+    uint32_t checksum_adjustment;
+    bool ret = f->serialize_single_directory (&c,
+					      flavor,
+					      tags_supplier,
+					      blobs_supplier,
+					      table_count,
+					      &checksum_adjustment);
+    c.end_serialize ();
+
+    if (ret)
+    {
+      const OT::OpenTypeFontFace &ot_face = f->get_face (0);
+      sfnt_size = dir_length;
+      for (unsigned int i = 0; i < table_count; i++)
+      {
+	const OT::TableRecord &rec = ot_face.get_table_by_tag (tables[i].tag);
+	tables[i].checksum = rec.checkSum;
+	sfnt_size += hb_ceil_to_4 (rec.length);
+      }
+    }
+    free (dir);
+    if (unlikely (!ret))
+      return false;
+
+    hb_woff_table_t *head = find_table (HB_OT_TAG_head);
+    if (head && hb_blob_get_length (head->blob) >= OT::head::static_size)
+    {
+      hb_blob_t *head_copy = hb_blob_copy_writable_or_fail (head->blob);
+      if (unlikely (!head_copy))
+	return false;
+      OT::head *h = (OT::head *) hb_blob_get_data_writable (head_copy, nullptr);
+      h->set_checksum_adjustment (checksum_adjustment);
+      hb_blob_destroy (head->blob);
+      head->blob = head_copy;
+    }
+
+    return true;
+  }
+
+  inline void fini (void)
+  {
+    for (unsigned int i = 0; i < tables.len; i++)
+      hb_blob_destroy (tables[i].blob);
+    tables.fini ();
+  }
+
+  inline hb_woff_table_t *find_table (hb_tag_t tag)
+  {
+    for (unsigned int i = 0; i < tables.len; i++)
+      if (tables[i].tag == tag)
+	return &tables[i];
+    return nullptr;
+  }
+
+  hb_vector_t<hb_woff_table_t> tables;
+  hb_tag_t flavor;
+  unsigned int sfnt_size;
+};
+
+
+/*
+ * WOFF.
+ */
+
+/* Returns the zlib-compressed table data, or the table itself if
+ * compressing does not make it smaller, as the format requires. */
+static hb_blob_t *
+_hb_woff_compress_table (hb_blob_t *blob)
+{
+#ifdef HAVE_ZLIB
+  unsigned int length;
+  const char *data = hb_blob_get_data (blob, &length);
+  uLongf compressed_length = compressBound (length);
+  char *compressed = (char *) malloc (compressed_length);
+  if (compressed &&
+      compress2 ((Bytef *) compressed, &compressed_length,
+		 (const Bytef *) data, length, Z_BEST_COMPRESSION) == Z_OK &&
+      compressed_length < length)
+    return hb_blob_create (compressed, compressed_length,
+			   HB_MEMORY_MODE_WRITABLE, compressed, free);
+  free (compressed);
+#endif
+
+  return hb_blob_reference (blob);
+}
+
+bool
+hb_subset_write_woff (hb_face_t            *face,
+		      hb_face_write_func_t  write_func,
+		      void                 *user_data)
+{
+  hb_woff_source_t source;
+  if (unlikely (!source.init (face)))
+  {
+    source.fini ();
+    return false;
+  }
+
+  unsigned int table_count = source.tables.len;
+  hb_auto_t<hb_vector_t<hb_blob_t *> > data;
+  unsigned int dir_length = OT::WOFFHeader::static_size +
+			    table_count * OT::WOFFTableDirectoryEntry::static_size;
+  char *dir = (char *) calloc (1, dir_length);
+  bool ret = dir && data.resize (table_count);
+
+  unsigned int offset = dir_length;
+  OT::WOFFTableDirectoryEntry *entries = (OT::WOFFTableDirectoryEntry *) (dir + OT::WOFFHeader::static_size);
+  for (unsigned int i = 0; ret && i < table_count; i++)
+  {
+    const hb_woff_table_t &table = source.tables[i];
+    unsigned int orig_length = hb_blob_get_length (table.blob);
+    data[i] = _hb_woff_compress_table (table.blob);
+    unsigned int comp_length = hb_blob_get_length (data[i]);
+    if (unlikely (comp_length == 0 && orig_length != 0))
+    {
+      data.resize (i + 1);
+      ret = false;
+      break;
+    }
+
+    entries[i].tag.set (table.tag);
+    entries[i].offset.set (offset);
+    entries[i].compLength.set (comp_length);
+    entries[i].origLength.set (orig_length);
+    entries[i].origChecksum.set (table.checksum);
+    offset += hb_ceil_to_4 (comp_length);
+  }
+
+  if (ret)
+  {
+    OT::WOFFHeader *header = (OT::WOFFHeader *) dir;
+    header->signature.set (HB_TAG ('w','O','F','F'));
+    header->flavor.set (source.flavor);
+    header->length.set (offset);
+    header->numTables.set (table_count);
+    header->totalSfntSize.set (source.sfnt_size);
+
+    ret = write_func (dir, dir_length, user_data);
+  }
+  free (dir);
+
+  static const char padding[4] = {};
+  for (unsigned int i = 0; ret && i < table_count; i++)
+  {
+    unsigned int length;
+    const char *table = hb_blob_get_data (data[i], &length);
+    ret = (!length || write_func (table, length, user_data)) &&
+	  (length % 4 == 0 || write_func (padding, 4 - length % 4, user_data));
+  }
+
+  for (unsigned int i = 0; i < data.len; i++)
+    hb_blob_destroy (data[i]);
+  source.fini ();
+  return ret;
+}
+
+
+/*
+ * WOFF2.
+ */
+
+#ifdef HAVE_BROTLI
+
+static const hb_tag_t woff2_known_tags[] =
+{
+  HB_TAG ('c','m','a','p'), HB_TAG ('h','e','a','d'), HB_TAG ('h','h','e','a'), HB_TAG ('h','m','t','x'),
+  HB_TAG ('m','a','x','p'), HB_TAG ('n','a','m','e'), HB_TAG ('O','S','/','2'), HB_TAG ('p','o','s','t'),
+  HB_TAG ('c','v','t',' '), HB_TAG ('f','p','g','m'), HB_TAG ('g','l','y','f'), HB_TAG ('l','o','c','a'),
+  HB_TAG ('p','r','e','p'), HB_TAG ('C','F','F',' '), HB_TAG ('V','O','R','G'), HB_TAG ('E','B','D','T'),
+  HB_TAG ('E','B','L','C'), HB_TAG ('g','a','s','p'), HB_TAG ('h','d','m','x'), HB_TAG ('k','e','r','n'),
+  HB_TAG ('L','T','S','H'), HB_TAG ('P','C','L','T'), HB_TAG ('V','D','M','X'), HB_TAG ('v','h','e','a'),
+  HB_TAG ('v','m','t','x'), HB_TAG ('B','A','S','E'), HB_TAG ('G','D','E','F'), HB_TAG ('G','P','O','S'),
+  HB_TAG ('G','S','U','B'), HB_TAG ('E','B','S','C'), HB_TAG ('J','S','T','F'), HB_TAG ('M','A','T','H'),
+  HB_TAG ('C','B','D','T'), HB_TAG ('C','B','L','C'), HB_TAG ('C','O','L','R'), HB_TAG ('C','P','A','L'),
+  HB_TAG ('S','V','G',' '), HB_TAG ('s','b','i','x'), HB_TAG ('a','c','n','t'), HB_TAG ('a','v','a','r'),
+  HB_TAG ('b','d','a','t'), HB_TAG ('b','l','o','c'), HB_TAG ('b','s','l','n'), HB_TAG ('c','v','a','r'),
+  HB_TAG ('f','d','s','c'), HB_TAG ('f','e','a','t'), HB_TAG ('f','m','t','x'), HB_TAG ('f','v','a','r'),
+  HB_TAG ('g','v','a','r'), HB_TAG ('h','s','t','y'), HB_TAG ('j','u','s','t'), HB_TAG ('l','c','a','r'),
+  HB_TAG ('m','o','r','t'), HB_TAG ('m','o','r','x'), HB_TAG ('o','p','b','d'), HB_TAG ('p','r','o','p'),
+  HB_TAG ('t','r','a','k'), HB_TAG ('Z','a','p','f'), HB_TAG ('S','i','l','f'), HB_TAG ('G','l','a','t'),
+  HB_TAG ('G','l','o','c'), HB_TAG ('F','e','a','t'), HB_TAG ('S','i','l','l'),
+};
+
+struct woff2_stream_t
+{
+  inline void init (void) { data.init (); }
+  inline void fini (void) { data.fini (); }
+
+  inline void push_u8 (unsigned int v) { data.push ((uint8_t) v); }
+  inline void push_u16 (unsigned int v) { push_u8 (v >> 8); push_u8 (v); }
+  inline void push_u32 (uint32_t v) { push_u16 (v >> 16); push_u16 (v); }
+
+  /* 255UInt16 encoding. */
+  inline void push_255_u16 (unsigned int v)
+  {
+    if (v < 253)
+      push_u8 (v);
+    else if (v < 506)
+    {
+      push_u8 (255);
+      push_u8 (v - 253);
+    }
+    else if (v < 762)
+    {
+      push_u8 (254);
+      push_u8 (v - 506);
+    }
+    else
+    {
+      push_u8 (253);
+      push_u16 (v);
+    }
+  }
+
+  /* UIntBase128 encoding. */
+  inline void push_base128 (uint32_t v)
+  {
+    unsigned int count = 1;
+    for (uint32_t rest = v >> 7; rest; rest >>= 7)
+      count++;
+    for (unsigned int i = count; i; i--)
+      push_u8 (((v >> (7 * (i - 1))) & 0x7F) | (i > 1 ? 0x80 : 0));
+  }
+
+  inline void append (const void *bytes, unsigned int length)
+  {
+    if (unlikely (!length || !data.alloc (data.len + length)))
+      return;
+    memcpy (data.arrayZ () + data.len, bytes, length);
+    data.len += length;
+  }
+
+  inline unsigned int length (void) const { return data.len; }
+  inline bool in_error (void) const { return data.in_error (); }
+
+  hb_vector_t<uint8_t> data;
+};
+
+/* Point deltas as a flag byte and 1 to 4 coordinate bytes. */
+static void
+_woff2_push_triplet (woff2_stream_t *flags, woff2_stream_t *glyphs,
+		     bool on_curve, int dx, int dy)
+{
+  unsigned int abs_x = abs (dx);
+  unsigned int abs_y = abs (dy);
+  unsigned int flag = on_curve ? 0 : 128;
+  unsigned int x_sign = dx < 0 ? 0 : 1;
+  unsigned int y_sign = dy < 0 ? 0 : 1;
+  unsigned int xy_signs = x_sign + 2 * y_sign;
+
+  if (dx == 0 && abs_y < 1280)
+  {
+    flags->push_u8 (flag + ((abs_y & 0xF00) >> 7) + y_sign);
+    glyphs->push_u8 (abs_y);
+  }
+  else if (dy == 0 && abs_x < 1280)
+  {
+    flags->push_u8 (flag + 10 + ((abs_x & 0xF00) >> 7) + x_sign);
+    glyphs->push_u8 (abs_x);
+  }
+  else if (abs_x < 65 && abs_y < 65)
+  {
+    flags->push_u8 (flag + 20 + ((abs_x - 1) & 0x30) + (((abs_y - 1) & 0x30) >> 2) + xy_signs);
+    glyphs->push_u8 ((((abs_x - 1) & 0xF) << 4) | ((abs_y - 1) & 0xF));
+  }
+  else if (abs_x < 769 && abs_y < 769)
+  {
+    flags->push_u8 (flag + 84 + 12 * (((abs_x - 1) & 0x300) >> 8) + (((abs_y - 1) & 0x300) >> 6) + xy_signs);
+    glyphs->push_u8 (abs_x - 1);
+    glyphs->push_u8 (abs_y - 1);
+  }
+  else if (abs_x < 4096 && abs_y < 4096)
+  {
+    flags->push_u8 (flag + 120 + xy_signs);
+    glyphs->push_u8 (abs_x >> 4);
+    glyphs->push_u8 ((abs_x << 4) | (abs_y >> 8));
+    glyphs->push_u8 (abs_y);
+  }
+  else
+  {
+    flags->push_u8 (flag + 124 + xy_signs);
+    glyphs->push_u16 (abs_x);
+    glyphs->push_u16 (abs_y);
+  }
+}
+
+struct woff2_glyf_streams_t
+{
+  enum { N_CONTOUR, N_POINTS, FLAG, GLYPH, COMPOSITE, BBOX, INSTRUCTION, STREAM_COUNT };
+
+  inline void init (void)
+  {
+    for (unsigned int i = 0; i < STREAM_COUNT; i++)
+      streams[i].init ();
+    point_flags.init ();
+    x_deltas.init ();
+    y_deltas.init ();
+  }
+  inline void fini (void)
+  {
+    for (unsigned int i = 0; i < STREAM_COUNT; i++)
+      streams[i].fini ();
+    point_flags.fini ();
+    x_deltas.fini ();
+    y_deltas.fini ();
+  }
+
+  inline void set_bbox_bit (unsigned int glyph)
+  { streams[BBOX].data[glyph >> 3] |= 0x80 >> (glyph & 7); }
+  inline void push_bbox (const OT::glyf::GlyphHeader &header)
+  {
+    streams[BBOX].append (&header.xMin, 4 * OT::FWORD::static_size);
+  }
+
+  /* Reads count coordinate deltas, as described by point_flags. */
+  inline bool read_deltas (const uint8_t **p, const uint8_t *end,
+			   unsigned int short_flag, unsigned int same_flag,
+			   hb_vector_t<int> *deltas)
+  {
+    deltas->resize (0);
+    for (unsigned int i = 0; i < point_flags.len; i++)
+    {
+      unsigned int flag = point_flags[i];
+      int delta = 0;
+      if (flag & short_flag)
+      {
+	if (unlikely (*p + 1 > end)) return false;
+	delta = (flag & same_flag) ? **p : -(int) **p;
+	*p += 1;
+      }
+      else if (!(flag & same_flag))
+      {
+	if (unlikely (*p + 2 > end)) return false;
+	delta = (int16_t) (((*p)[0] << 8) | (*p)[1]);
+	*p += 2;
+      }
+      deltas->push (delta);
+    }
+    return !deltas->in_error ();
+  }
+
+  inline bool add_simple_glyph (unsigned int glyph,
+				const uint8_t *data, unsigned int length)
+  {
+    typedef OT::glyf::accelerator_t glyf_accelerator_t;
+
+    const OT::glyf::GlyphHeader &header = StructAtOffset<OT::glyf::GlyphHeader> (data, 0);
+    unsigned int num_contours = header.numberOfContours;
+    const uint8_t *p = data + OT::glyf::GlyphHeader::static_size;
+    const uint8_t *end = data + length;
+    if (unlikely (p + 2 * num_contours + 2 > end)) return false;
+
+    streams[N_CONTOUR].push_u16 (num_contours);
+    unsigned int num_points = 0;
+    for (unsigned int i = 0; i < num_contours; i++, p += 2)
+    {
+      unsigned int end_point = (p[0] << 8) | p[1];
+      if (unlikely (end_point + 1 <= num_points)) return false;
+      streams[N_POINTS].push_255_u16 (end_point + 1 - num_points);
+      num_points = end_point + 1;
+    }
+
+    unsigned int instruction_length = (p[0] << 8) | p[1];
+    p += 2;
+    const uint8_t *instructions = p;
+    p += instruction_length;
+    if (unlikely (p > end)) return false;
+
+    point_flags.resize (0);
+    while (point_flags.len < num_points)
+    {
+      if (unlikely (p >= end)) return false;
+      uint8_t flag = *p++;
+      unsigned int repeat = 1;
+      if (flag & glyf_accelerator_t::FLAG_REPEAT)
+      {
+	if (unlikely (p >= end)) return false;
+	repeat += *p++;
+      }
+      if (unlikely (point_flags.len + repeat > num_points)) return false;
+      for (unsigned int i = 0; i < repeat; i++)
+	point_flags.push (flag);
+    }
+    if (unlikely (point_flags.in_error ())) return false;
+    /* Not kept without the overlapSimpleBitmap, which we do not write. */
+    if (point_flags[0] & glyf_accelerator_t::FLAG_OVERLAP_SIMPLE) return false;
+
+    if (unlikely (!read_deltas (&p, end,
+				glyf_accelerator_t::FLAG_X_SHORT,
+				glyf_accelerator_t::FLAG_X_SAME,
+				&x_deltas) ||
+		  !read_deltas (&p, end,
+				glyf_accelerator_t::FLAG_Y_SHORT,
+				glyf_accelerator_t::FLAG_Y_SAME,
+				&y_deltas)))
+      return false;
+
+    int x = 0, y = 0;
+    int x_min = 0, y_min = 0, x_max = 0, y_max = 0;
+    for (unsigned int i = 0; i < num_points; i++)
+    {
+      _woff2_push_triplet (&streams[FLAG], &streams[GLYPH],
+			   point_flags[i] & glyf_accelerator_t::FLAG_ON_CURVE,
+			   x_deltas[i], y_deltas[i]);
+      x += x_deltas[i];
+      y += y_deltas[i];
+      if (!i || x < x_min) x_min = x;
+      if (!i || y < y_min) y_min = y;
+      if (!i || x > x_max) x_max = x;
+      if (!i || y > y_max) y_max = y;
+    }
+
+    /* The bounding box can be left out if it is the one of the points. */
+    if (x_min != header.xMin || y_min != header.yMin ||
+	x_max != header.xMax || y_max != header.yMax)
+    {
+      set_bbox_bit (glyph);
+      push_bbox (header);
+    }
+
+    streams[GLYPH].push_255_u16 (instruction_length);
+    streams[INSTRUCTION].append (instructions, instruction_length);
+    return true;
+  }
+
+  inline bool add_composite_glyph (unsigned int glyph,
+				   const uint8_t *data, unsigned int length)
+  {
+    typedef OT::glyf::CompositeGlyphHeader CompositeGlyphHeader;
+
+    unsigned int offset = OT::glyf::GlyphHeader::static_size;
+    bool have_instructions = false;
+    const CompositeGlyphHeader *composite;
+    do
+    {
+      composite = &StructAtOffset<CompositeGlyphHeader> (data, offset);
+      if (unlikely (offset + CompositeGlyphHeader::min_size > length ||
+		    offset + composite->get_size () > length))
+	return false;
+      have_instructions |= (bool) (composite->flags & CompositeGlyphHeader::WE_HAVE_INSTRUCTIONS);
+      offset += composite->get_size ();
+    } while (composite->flags & CompositeGlyphHeader::MORE_COMPONENTS);
+
+    streams[N_CONTOUR].push_u16 (0xFFFFu);
+    streams[COMPOSITE].append (data + OT::glyf::GlyphHeader::static_size,
+			       offset - OT::glyf::GlyphHeader::static_size);
+    set_bbox_bit (glyph);
+    push_bbox (StructAtOffset<OT::glyf::GlyphHeader> (data, 0));
+
+    if (have_instructions)
+    {
+      if (unlikely (offset + 2 > length)) return false;
+      unsigned int instruction_length = (data[offset] << 8) | data[offset + 1];
+      offset += 2;
+      if (unlikely (offset + instruction_length > length)) return false;
+      streams[GLYPH].push_255_u16 (instruction_length);
+      streams[INSTRUCTION].append (data + offset, instruction_length);
+    }
+    return true;
+  }
+
+  woff2_stream_t streams[STREAM_COUNT];
+  hb_vector_t<uint8_t> point_flags;
+  hb_vector_t<int> x_deltas;
+  hb_vector_t<int> y_deltas;
+};
+
+/* Writes the glyf table in the transformed format of WOFF2, which leaves
+ * out loca, and splits glyph data into streams that compress better.
+ * Returns false if the table cannot be transformed without loss. */
+static bool
+_woff2_transform_glyf (hb_blob_t *glyf_blob,
+		       hb_blob_t *loca_blob,
+		       bool short_loca,
+		       woff2_stream_t *out)
+{
+  unsigned int glyf_length, loca_length;
+  const uint8_t *glyf = (const uint8_t *) hb_blob_get_data (glyf_blob, &glyf_length);
+  const uint8_t *loca = (const uint8_t *) hb_blob_get_data (loca_blob, &loca_length);
+  unsigned int entry_size = short_loca ? 2 : 4;
+  if (unlikely (loca_length < entry_size || loca_length % entry_size))
+    return false;
+  unsigned int num_glyphs = loca_length / entry_size - 1;
+  if (unlikely (num_glyphs > 0xFFFFu))
+    return false;
+  /* The decoder pads glyphs to four bytes, which must fit short offsets. */
+  if (short_loca && glyf_length + 3 * num_glyphs > 0x1FFFCu)
+    return false;
+
+  woff2_glyf_streams_t s;
+  s.init ();
+  unsigned int bitmap_length = ((num_glyphs + 31) >> 5) << 2;
+  bool ret = s.streams[woff2_glyf_streams_t::BBOX].data.resize (bitmap_length);
+  if (ret)
+    memset (s.streams[woff2_glyf_streams_t::BBOX].data.arrayZ (), 0, bitmap_length);
+
+  for (unsigned int i = 0; ret && i < num_glyphs; i++)
+  {
+    unsigned int start, end;
+    if (short_loca)
+    {
+      start = 2 * StructAtOffset<OT::HBUINT16> (loca, 2 * i);
+      end = 2 * StructAtOffset<OT::HBUINT16> (loca, 2 * i + 2);
+    }
+    else
+    {
+      start = StructAtOffset<OT::HBUINT32> (loca, 4 * i);
+      end = StructAtOffset<OT::HBUINT32> (loca, 4 * i + 4);
+    }
+    if (unlikely (start > end || end > glyf_length))
+    {
+      ret = false;
+      break;
+    }
+
+    if (end - start < OT::glyf::GlyphHeader::static_size)
+    {
+      /* An empty glyph; anything shorter than a header has no outline. */
+      if (unlikely (end != start)) ret = false;
+      s.streams[woff2_glyf_streams_t::N_CONTOUR].push_u16 (0);
+      continue;
+    }
+
+    int num_contours = StructAtOffset<OT::glyf::GlyphHeader> (glyf, start).numberOfContours;
+    if (num_contours > 0)
+      ret = s.add_simple_glyph (i, glyf + start, end - start);
+    else if (num_contours == -1)
+      ret = s.add_composite_glyph (i, glyf + start, end - start);
+    else
+      ret = false; /* Would not survive the round-trip. */
+  }
+
+  for (unsigned int i = 0; i < woff2_glyf_streams_t::STREAM_COUNT; i++)
+    ret = ret && !s.streams[i].in_error ();
+
+  if (ret)
+  {
+    OT::WOFF2TransformedGlyfHeader header;
+    memset (&header, 0, sizeof (header));
+    header.numGlyphs.set (num_glyphs);
+    header.indexFormat.set (short_loca ? 0 : 1);
+    header.nContourStreamSize.set (s.streams[woff2_glyf_streams_t::N_CONTOUR].length ());
+    header.nPointsStreamSize.set (s.streams[woff2_glyf_streams_t::N_POINTS].length ());
+    header.flagStreamSize.set (s.streams[woff2_glyf_streams_t::FLAG].length ());
+    header.glyphStreamSize.set (s.streams[woff2_glyf_streams_t::GLYPH].length ());
+    header.compositeStreamSize.set (s.streams[woff2_glyf_streams_t::COMPOSITE].length ());
+    header.bboxStreamSize.set (s.streams[woff2_glyf_streams_t::BBOX].length ());
+    header.instructionStreamSize.set (s.streams[woff2_glyf_streams_t::INSTRUCTION].length ());
+    out->append (&header, OT::WOFF2TransformedGlyfHeader::static_size);
+    for (unsigned int i = 0; i < woff2_glyf_streams_t::STREAM_COUNT; i++)
+      out->append (s.streams[i].data.arrayZ (), s.streams[i].length ());
+    ret = !out->in_error ();
+  }
+
+  s.fini ();
+  return ret;
+}
+
+bool
+hb_subset_write_woff2 (hb_face_t            *face,
+		       hb_face_write_func_t  write_func,
+		       void                 *user_data)
+{
+  hb_woff_source_t source;
+  if (unlikely (!source.init (face)))
+  {
+    source.fini ();
+    return false;
+  }
+
+  hb_woff_table_t *glyf = source.find_table (HB_OT_TAG_glyf);
+  hb_woff_table_t *loca = source.find_table (HB_OT_TAG_loca);
+  hb_woff_table_t *head = source.find_table (HB_OT_TAG_head);
+
+  woff2_stream_t transformed_glyf;
+  transformed_glyf.init ();
+  bool transform = false;
+  if (glyf && loca && head && hb_blob_get_length (head->blob) >= OT::head::static_size)
+  {
+    OT::head *h = (OT::head *) hb_blob_get_data_writable (head->blob, nullptr);
+    transform = h->indexToLocFormat <= 1 &&
+		_woff2_transform_glyf (glyf->blob, loca->blob,
+				       h->indexToLocFormat == 0,
+				       &transformed_glyf);
+    if (transform)
+      h->set_lossless ();
+  }
+
+  /* Tables in tag order, except that loca must follow glyf. */
+  unsigned int table_count = source.tables.len;
+  woff2_stream_t dir, font_data;
+  dir.init ();
+  font_data.init ();
+  for (unsigned int i = 0; i < table_count; i++)
+  {
+    hb_woff_table_t *table = &source.tables[i];
+    if (table == loca && glyf)
+      continue;
+
+    unsigned int count = table == glyf && loca ? 2 : 1;
+    for (unsigned int j = 0; j < count; j++, table = loca)
+    {
+      unsigned int index = 0;
+      while (index < ARRAY_LENGTH (woff2_known_tags) && woff2_known_tags[index] != table->tag)
+	index++;
+      /* Transformation version 0 is the null transform, except for glyf
+       * and loca, which it transforms; for those, 3 is the null one. */
+      unsigned int version = 0;
+      if ((table == glyf || table == loca) && !transform)
+	version = 3;
+
+      dir.push_u8 (index | (version << 6));
+      if (index == ARRAY_LENGTH (woff2_known_tags))
+	dir.push_u32 (table->tag);
+      dir.push_base128 (hb_blob_get_length (table->blob));
+
+      if (transform && table == glyf)
+      {
+	dir.push_base128 (transformed_glyf.length ());
+	font_data.append (transformed_glyf.data.arrayZ (), transformed_glyf.length ());
+      }
+      else if (transform && table == loca)
+	dir.push_base128 (0);
+      else
+      {
+	unsigned int length;
+	const char *data = hb_blob_get_data (table->blob, &length);
+	font_data.append (data, length);
+      }
+    }
+  }
+  transformed_glyf.fini ();
+
+  size_t compressed_length = BrotliEncoderMaxCompressedSize (font_data.length ());
+  uint8_t *compressed = compressed_length ? (uint8_t *) malloc (compressed_length) : nullptr;
+  bool ret = !dir.in_error () && !font_data.in_error () && compressed &&
+	     BrotliEncoderCompress (BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_FONT,
+				    font_data.length (), font_data.data.arrayZ (),
+				    &compressed_length, compressed);
+  font_data.fini ();
+
+  if (ret)
+  {
+    unsigned int length = OT::WOFF2Header::static_size + dir.length () + compressed_length;
+    OT::WOFF2Header header;
+    memset (&header, 0, sizeof (header));
+    header.signature.set (HB_TAG ('w','O','F','2'));
+    header.flavor.set (source.flavor);
+    header.length.set (hb_ceil_to_4 (length));
+    header.numTables.set (table_count);
+    header.totalSfntSize.set (source.sfnt_size);
+    header.totalCompressedSize.set (compressed_length);
+
+    static const char padding[4] = {};
+    ret = write_func ((const char *) &header, OT::WOFF2Header::static_size, user_data) &&
+	  write_func ((const char *) dir.data.arrayZ (), dir.length (), user_data) &&
+	  write_func ((const char *) compressed, compressed_length, user_data) &&
+	  (length % 4 == 0 || write_func (padding, 4 - length % 4, user_data));
+  }
+
+  free (compressed);
+  dir.fini ();
+  source.fini ();
+  return ret;
+}
+
+#else
+
+bool
+hb_subset_write_woff2 (hb_face_t            *face HB_UNUSED,
+		       hb_face_write_func_t  write_func HB_UNUSED,
+		       void                 *user_data HB_UNUSED)
+{
+  /* WOFF2 needs brotli. */
+  return false;
+}
+
+#endif
@@ -29,6 +29,7 @@
 
 #include "hb-subset.hh"
 #include "hb-subset-glyf.hh"
+#include "hb-subset-woff.hh"
 
 #include "hb-open-file.hh"
 #include "hb-ot-cmap-table.hh"
@@ -68,27 +69,30 @@ _subset2 (hb_subset_plan_t *plan)
   hb_bool_t result = false;
   if (source_blob->data)
   {
-    hb_auto_t<hb_vector_t<char> > buf;
     unsigned int buf_size = _plan_estimate_subset_table_size (plan, source_blob->length);
     DEBUG_MSG(SUBSET, nullptr, "OT::%c%c%c%c initial estimated table size: %u bytes.", HB_UNTAG(tag), buf_size);
-    if (unlikely (!buf.alloc (buf_size)))
+  retry:
+    /* Grows in place where address space can be reserved; only retried
+     * from scratch where it cannot. */
+    hb_serialize_context_t serializer (buf_size);
+    if (unlikely (!serializer.start))
     {
       DEBUG_MSG(SUBSET, nullptr, "OT::%c%c%c%c failed to allocate %u bytes.", HB_UNTAG(tag), buf_size);
+      hb_blob_destroy (source_blob);
       return false;
     }
-  retry:
-    hb_serialize_context_t serializer (buf.arrayZ(), buf_size);
     hb_subset_context_t c (plan, &serializer);
     result = table->subset (&c);
     if (serializer.ran_out_of_room)
     {
-      buf_size += (buf_size >> 1) + 32;
-      DEBUG_MSG(SUBSET, nullptr, "OT::%c%c%c%c ran out of room; reallocating to %u bytes.", HB_UNTAG(tag), buf_size);
-      if (unlikely (!buf.alloc (buf_size)))
+      if (unlikely (buf_size >= (unsigned int) -1 / 2))
       {
-	DEBUG_MSG(SUBSET, nullptr, "OT::%c%c%c%c failed to reallocate %u bytes.", HB_UNTAG(tag), buf_size);
+	DEBUG_MSG(SUBSET, nullptr, "OT::%c%c%c%c ran out of room.", HB_UNTAG(tag));
+	hb_blob_destroy (source_blob);
 	return false;
       }
+      buf_size = MAX (buf_size + (buf_size >> 1) + 32, serializer.length ());
+      DEBUG_MSG(SUBSET, nullptr, "OT::%c%c%c%c ran out of room; reallocating to %u bytes.", HB_UNTAG(tag), buf_size);
       goto retry;
     }
     if (result)
@@ -132,9 +136,9 @@ _subset (hb_subset_plan_t *plan)
 }
 
 
-static bool
-_subset_table (hb_subset_plan_t *plan,
-               hb_tag_t          tag)
+bool
+hb_subset_table (hb_subset_plan_t *plan,
+		 hb_tag_t          tag)
 {
   DEBUG_MSG(SUBSET, nullptr, "begin subset %c%c%c%c", HB_UNTAG(tag));
   bool result = true;
@@ -198,8 +202,8 @@ _subset_table (hb_subset_plan_t *plan,
   return result;
 }
 
-static bool
-_should_drop_table(hb_subset_plan_t *plan, hb_tag_t tag)
+bool
+hb_subset_should_drop_table (hb_subset_plan_t *plan, hb_tag_t tag)
 {
   switch (tag) {
     case HB_TAG ('c', 'v', 'a', 'r'): /* hint table, fallthrough */
@@ -239,6 +243,77 @@ _should_drop_table(hb_subset_plan_t *plan, hb_tag_t tag)
   }
 }
 
+/* The plan is shared between tasks; each stages the tables it produces
+ * in its own hb_subset_plan_t::task_t. */
+static void
+_hb_subset_task (void *task_data, unsigned int task_index)
+{
+  hb_subset_plan_t *plan = (hb_subset_plan_t *) task_data;
+  hb_subset_plan_t::task_t &task = (*plan->tasks)[task_index];
+  task.success = hb_subset_table (plan, task.tag);
+}
+
+static bool
+_subset_tables_parallel (hb_subset_plan_t           *plan,
+			 hb_face_task_runner_func_t  runner,
+			 void                       *user_data)
+{
+  hb_vector_t<hb_subset_plan_t::task_t> tasks;
+  tasks.init ();
+
+  hb_tag_t table_tags[32];
+  unsigned int offset = 0, count;
+  do {
+    count = ARRAY_LENGTH (table_tags);
+    hb_face_get_table_tags (plan->source, offset, &count, table_tags);
+    for (unsigned int i = 0; i < count; i++)
+    {
+      hb_tag_t tag = table_tags[i];
+      if (hb_subset_should_drop_table (plan, tag))
+      {
+        DEBUG_MSG(SUBSET, nullptr, "drop %c%c%c%c", HB_UNTAG(tag));
+        continue;
+      }
+      hb_subset_plan_t::task_t *task = tasks.push ();
+      task->tag = tag;
+      task->success = false;
+      task->tables.init ();
+    }
+    offset += count;
+  } while (count == ARRAY_LENGTH (table_tags));
+
+  bool success = !tasks.in_error ();
+  if (success)
+  {
+    /* Load what the tasks would otherwise race to cache.  Through the
+     * public getters, as calls to the pure inline ones may be dropped. */
+    hb_face_get_glyph_count (plan->source);
+    hb_face_get_upem (plan->source);
+    plan->glyphset->get_population ();
+    plan->unicodes->get_population ();
+
+    plan->tasks = &tasks;
+    runner (_hb_subset_task, plan, tasks.len, user_data);
+    plan->tasks = nullptr;
+  }
+
+  /* Assemble in source table order, as the serial path would. */
+  for (unsigned int i = 0; i < tasks.len; i++)
+  {
+    hb_subset_plan_t::task_t &task = tasks[i];
+    success = success && task.success;
+    for (unsigned int j = 0; j < task.tables.len; j++)
+    {
+      success = success && plan->add_table (task.tables[j].tag, task.tables[j].blob);
+      hb_blob_destroy (task.tables[j].blob);
+    }
+    task.tables.fini ();
+  }
+
+  tasks.fini ();
+  return success;
+}
+
 /**
  * hb_subset:
  * @source: font face data to be subset.
@@ -249,31 +324,203 @@ _should_drop_table(hb_subset_plan_t *plan, hb_tag_t tag)
 hb_face_t *
 hb_subset (hb_face_t *source,
            hb_subset_input_t *input)
+{
+  return hb_subset_parallel (source, input, nullptr, nullptr);
+}
+
+/**
+ * hb_subset_parallel:
+ * @source: font face data to be subset.
+ * @input: input to use for the subsetting.
+ * @runner: (nullable): function to run independent tasks with.
+ * @user_data: data to pass to @runner.
+ *
+ * Subsets a font according to provided input, like hb_subset().  Once
+ * the glyphs to retain are known, each table is subset in a task of its
+ * own, and the tasks are handed to @runner, such that they can run
+ * concurrently on a thread pool of the caller's.  If @runner is %NULL,
+ * tables are subset one after the other on the calling thread.
+ *
+ * The result does not depend on the order the tasks run in; it is
+ * identical to that of hb_subset().
+ *
+ * Since: REPLACEME
+ **/
+hb_face_t *
+hb_subset_parallel (hb_face_t                  *source,
+		    hb_subset_input_t          *input,
+		    hb_face_task_runner_func_t  runner,
+		    void                       *user_data)
 {
   if (unlikely (!input || !source)) return hb_face_get_empty();
 
   hb_subset_plan_t *plan = hb_subset_plan_create (source, input);
 
-  hb_tag_t table_tags[32];
-  unsigned int offset = 0, count;
   bool success = true;
-  do {
-    count = ARRAY_LENGTH (table_tags);
-    hb_face_get_table_tags (source, offset, &count, table_tags);
-    for (unsigned int i = 0; i < count; i++)
-    {
-      hb_tag_t tag = table_tags[i];
-      if (_should_drop_table(plan, tag))
+  if (runner)
+    success = _subset_tables_parallel (plan, runner, user_data);
+  else
+  {
+    hb_tag_t table_tags[32];
+    unsigned int offset = 0, count;
+    do {
+      count = ARRAY_LENGTH (table_tags);
+      hb_face_get_table_tags (source, offset, &count, table_tags);
+      for (unsigned int i = 0; i < count; i++)
       {
-        DEBUG_MSG(SUBSET, nullptr, "drop %c%c%c%c", HB_UNTAG(tag));
-        continue;
+        hb_tag_t tag = table_tags[i];
+        if (hb_subset_should_drop_table (plan, tag))
+        {
+          DEBUG_MSG(SUBSET, nullptr, "drop %c%c%c%c", HB_UNTAG(tag));
+          continue;
+        }
+        success = success && hb_subset_table (plan, tag);
       }
-      success = success && _subset_table (plan, tag);
-    }
-    offset += count;
-  } while (success && count == ARRAY_LENGTH (table_tags));
+      offset += count;
+    } while (success && count == ARRAY_LENGTH (table_tags));
+  }
 
   hb_face_t *result = success ? hb_face_reference(plan->dest) : hb_face_get_empty();
   hb_subset_plan_destroy (plan);
   return result;
 }
+
+struct hb_subset_batch_closure_t
+{
+  hb_face_t *source;
+  hb_subset_input_t **inputs;
+  hb_face_t **subsets;
+};
+
+static void
+_hb_subset_batch_task (void *task_data, unsigned int task_index)
+{
+  hb_subset_batch_closure_t *closure = (hb_subset_batch_closure_t *) task_data;
+  closure->subsets[task_index] = hb_subset (closure->source,
+					    closure->inputs[task_index]);
+}
+
+/**
+ * hb_subset_batch:
+ * @source: font face data to be subset.
+ * @inputs: (array length=count): inputs to use for the subsetting.
+ * @count: number of @inputs.
+ * @subsets: (out) (array length=count): array to write the subsets into.
+ * @runner: (nullable): function to run independent tasks with.
+ * @user_data: data to pass to @runner.
+ *
+ * Subsets @source once for each of @inputs, like hb_subset(), and stores
+ * the results in the same order in @subsets.  Work that only depends on
+ * @source, like sanitizing its tables and building glyph lookups, is done
+ * once and shared by all subsets.
+ *
+ * Each subset is a task handed to @runner, such that they can run
+ * concurrently on a thread pool of the caller's.  If @runner is %NULL,
+ * subsets are made one after the other on the calling thread.
+ *
+ * The trusted-table digests of @source are honored, and tables the batch
+ * sanitizes are recorded on @source as hb_subset() would; see
+ * hb_face_set_trusted_tables().  Closures cached on @source by earlier
+ * calls to hb_subset() are not used, nor are those of the batch kept.
+ *
+ * Since: REPLACEME
+ **/
+void
+hb_subset_batch (hb_face_t                  *source,
+		 hb_subset_input_t         **inputs,
+		 unsigned int                count,
+		 hb_face_t                 **subsets, /* OUT */
+		 hb_face_task_runner_func_t  runner,
+		 void                       *user_data)
+{
+  if (unlikely (!count || !subsets)) return;
+  if (unlikely (!source || !inputs))
+  {
+    for (unsigned int i = 0; i < count; i++)
+      subsets[i] = hb_face_get_empty ();
+    return;
+  }
+
+  /* For faces made from a blob, a face of our own on the same data, such
+   * that sanitized tables and the closure cache live as long as the batch,
+   * and not longer.  Other faces, like those of hb_face_create_for_tables()
+   * or face builders, do not hand out their data as one blob, and are
+   * shared as they are. */
+  hb_face_t *shared = nullptr;
+  if (source->for_data)
+  {
+    hb_blob_t *blob = hb_face_reference_blob (source);
+    shared = hb_face_create (blob, hb_face_get_index (source));
+    hb_blob_destroy (blob);
+    hb_face_set_upem (shared, hb_face_get_upem (source));
+    hb_face_set_glyph_count (shared, hb_face_get_glyph_count (source));
+    bool success = true;
+    if (source->trust)
+    {
+      hb_lock_t lock (source->trust->lock);
+      success = hb_face_set_trusted_tables (shared,
+					    source->trust->trusted.arrayZ (),
+					    source->trust->trusted.len);
+    }
+    if (unlikely (!success || !_hb_face_keep_sanitized_tables (shared)))
+    {
+      hb_face_destroy (shared);
+      shared = nullptr;
+    }
+  }
+  if (!shared)
+    shared = hb_face_reference (source);
+
+  hb_subset_batch_closure_t closure = {shared, inputs, subsets};
+  if (runner)
+    runner (_hb_subset_batch_task, &closure, count, user_data);
+  else
+    for (unsigned int i = 0; i < count; i++)
+      _hb_subset_batch_task (&closure, i);
+
+  /* Kept tables passed sanitization; record them on the source, which
+   * ignores this unless in trusted-tables mode. */
+  if (shared != source)
+  {
+    hb_face_trust_t *trust = shared->trust;
+    for (unsigned int i = 0; i < trust->sanitized_tables.len; i++)
+      _hb_face_table_sanitized (source, trust->sanitized_tables[i].tag,
+				trust->sanitized_tables[i].blob);
+  }
+
+  hb_face_destroy (shared);
+}
+
+/**
+ * hb_subset_write:
+ * @subset: a face returned by hb_subset().
+ * @format: the file format to write.
+ * @write_func: function to write the file data with.
+ * @user_data: data to pass to @write_func.
+ *
+ * Writes @subset as a font file in @format, in pieces, by calling
+ * @write_func repeatedly.  For %HB_SUBSET_OUTPUT_FORMAT_SFNT this is the
+ * same as hb_face_builder_write().  WOFF tables are compressed if HarfBuzz
+ * was built with zlib, and stored uncompressed otherwise.  WOFF2 needs
+ * HarfBuzz to be built with brotli; glyf and loca are transformed, as the
+ * format allows, unless that would lose data.
+ *
+ * Return value: false if @format is not supported, allocation failed,
+ * or @write_func returned false; true otherwise.
+ *
+ * Since: REPLACEME
+ **/
+hb_bool_t
+hb_subset_write (hb_face_t                 *subset,
+		 hb_subset_output_format_t  format,
+		 hb_face_write_func_t       write_func,
+		 void                      *user_data)
+{
+  switch (format)
+  {
+  case HB_SUBSET_OUTPUT_FORMAT_SFNT:	return hb_face_builder_write (subset, write_func, user_data);
+  case HB_SUBSET_OUTPUT_FORMAT_WOFF:	return hb_subset_write_woff (subset, write_func, user_data);
+  case HB_SUBSET_OUTPUT_FORMAT_WOFF2:	return hb_subset_write_woff2 (subset, write_func, user_data);
+  default:				return false;
+  }
+}
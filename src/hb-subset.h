@@ -72,6 +72,43 @@ HB_EXTERN hb_face_t *
 hb_subset (hb_face_t *source,
            hb_subset_input_t *input);
 
+HB_EXTERN hb_face_t *
+hb_subset_parallel (hb_face_t                  *source,
+		    hb_subset_input_t          *input,
+		    hb_face_task_runner_func_t  runner,
+		    void                       *user_data);
+
+HB_EXTERN void
+hb_subset_batch (hb_face_t                  *source,
+		 hb_subset_input_t         **inputs,
+		 unsigned int                count,
+		 hb_face_t                 **subsets, /* OUT */
+		 hb_face_task_runner_func_t  runner,
+		 void                       *user_data);
+
+
+/**
+ * hb_subset_output_format_t:
+ * @HB_SUBSET_OUTPUT_FORMAT_SFNT: an OpenType font file.
+ * @HB_SUBSET_OUTPUT_FORMAT_WOFF: a WOFF 1.0 file.
+ * @HB_SUBSET_OUTPUT_FORMAT_WOFF2: a WOFF 2.0 file.
+ *
+ * The file formats hb_subset_write() can write.
+ *
+ * Since: REPLACEME
+ */
+typedef enum {
+  HB_SUBSET_OUTPUT_FORMAT_SFNT,
+  HB_SUBSET_OUTPUT_FORMAT_WOFF,
+  HB_SUBSET_OUTPUT_FORMAT_WOFF2
+} hb_subset_output_format_t;
+
+HB_EXTERN hb_bool_t
+hb_subset_write (hb_face_t                 *subset,
+		 hb_subset_output_format_t  format,
+		 hb_face_write_func_t       write_func,
+		 void                      *user_data);
+
 
 HB_END_DECLS
 
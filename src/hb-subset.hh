@@ -56,5 +56,14 @@ struct hb_subset_context_t :
 			debug_depth (0) {}
 };
 
+/* The steps of hb_subset(), once the plan is made; also used by
+ * test-subset-bench to time each table on its own. */
+
+HB_INTERNAL bool
+hb_subset_should_drop_table (hb_subset_plan_t *plan, hb_tag_t tag);
+
+HB_INTERNAL bool
+hb_subset_table (hb_subset_plan_t *plan, hb_tag_t tag);
+
 
 #endif /* HB_SUBSET_HH */
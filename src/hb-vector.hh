@@ -81,6 +81,10 @@ struct hb_vector_t
 
   inline bool in_error (void) const { return allocated == 0; }
 
+  /* Heap memory used, not counting the vector itself. */
+  inline unsigned int get_memory_usage (void) const
+  { return arrayZ_ ? allocated * sizeof (Type) : 0; }
+
   /* Allocate for size but don't adjust len. */
   inline bool alloc (unsigned int size)
   {
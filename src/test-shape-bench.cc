@@ -0,0 +1,372 @@
+/*
+ * Copyright © 2018  Google, Inc.
+ *
+ *  This is part of HarfBuzz, a text shaping library.
+ *
+ * Permission is hereby granted, without written agreement and without
+ * license or royalty fees, to use, copy, modify, and distribute this
+ * software and its documentation for any purpose, provided that the
+ * above copyright notice and the following two paragraphs appear in
+ * all copies of this software.
+ *
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES
+ * ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN
+ * IF THE COPYRIGHT HOLDER HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * THE COPYRIGHT HOLDER SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING,
+ * BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE COPYRIGHT HOLDER HAS NO OBLIGATION TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ */
+
+#include "hb.hh"
+#include "hb-time.hh"
+#include "hb-bench-alloc.hh"
+
+#include "hb.h"
+#include "hb-ot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Shaping benchmark.
+ *
+ * Shapes a small per-script corpus, built from the fonts and strings of the
+ * shaping and API test suites, and prints one tab-separated line per case.
+ * The first line names the format and its version; the second one names the
+ * columns.  Columns are only ever appended, so scripts tracking regressions
+ * across commits can keep reading the ones they know about.
+ *
+ *   case            Name of the case; stable across versions.
+ *   script          ISO 15924 tag of the text.
+ *   codepoints      Length of the input.
+ *   glyphs          Length of the output.
+ *   iterations      Shaping calls per timed round.
+ *   ns_per_glyph    Shaping time with a warm font and plan.
+ *   plan_ns         Creating a shape-plan against a warm face.
+ *   cold_face_ns    Creating face and font and shaping the text once.
+ *   shape_allocs    Number of malloc(), calloc() and realloc() calls per
+ *                   shaping call, with a warm font and plan.
+ *   shape_bytes     Bytes requested by those calls.
+ *   plan_allocs     The same, creating a shape-plan.
+ *   plan_bytes      Bytes requested by those calls.
+ *   cold_allocs     The same, for the cold face case.
+ *   cold_bytes      Bytes requested by those calls.
+ *   cold_peak_bytes Peak heap usage during the cold face case.
+ *   face_bytes      Heap still held by the face and font of the cold face
+ *                   case, its cached shape-plan included, after shaping.
+ *   buffer_bytes    Heap held by a fresh buffer after shaping the text.
+ *
+ * Times are the median over all rounds.
+ *
+ * This program links a copy of the library of its own, built with
+ * hb_malloc_impl and friends pointing to the counting allocator of
+ * hb-bench-alloc.hh.
+ */
+
+#define BENCH_FORMAT_VERSION 1
+#define BENCH_TEXT_MAX 16
+
+#define IN_HOUSE "test/shaping/data/in-house/fonts/"
+#define API "test/api/fonts/"
+
+enum bench_length_t
+{
+  BENCH_WORD,		/* The text once. */
+  BENCH_PARAGRAPH,	/* The text repeated, space-separated. */
+  BENCH_RUN,		/* The text repeated with no break. */
+  BENCH_STACK		/* The first character, then the rest repeated
+			 * with no break. */
+};
+
+struct bench_case_t
+{
+  const char *name;
+  const char *font;
+  bench_length_t length;
+  unsigned int run_length;	/* Of BENCH_RUN and BENCH_STACK texts. */
+  unsigned int text[BENCH_TEXT_MAX];
+};
+
+/* Texts are zero-terminated. */
+static const bench_case_t cases[] =
+{
+  {"latin-word",	API "Roboto-Regular.gsub.fi.ttf",	BENCH_WORD, 0,
+   {'o', 'f', 'f', 'i', 'c', 'e'}},
+  {"latin-paragraph",	API "Roboto-Regular.gsub.fi.ttf",	BENCH_PARAGRAPH, 0,
+   {'o', 'f', 'f', 'i', 'c', 'e'}},
+  {"cjk-paragraph",	API "Mplus1p-Regular.660E,6975,73E0,5EA6,8F38,6E05.ttf", BENCH_PARAGRAPH, 0,
+   {0x660E, 0x6975, 0x73E0, 0x5EA6, 0x8F38, 0x6E05}},
+  {"arabic-word",	IN_HOUSE "641ca9d7808b01cafa9a666c13811c9b56eb9c52.ttf", BENCH_WORD, 0,
+   {0x064A, 0x0633, 0x06E1, 0x200D, 0x0654, 0x064E, 0x0644}},
+  {"arabic-paragraph",	IN_HOUSE "641ca9d7808b01cafa9a666c13811c9b56eb9c52.ttf", BENCH_PARAGRAPH, 0,
+   {0x064A, 0x0633, 0x06E1, 0x200D, 0x0654, 0x064E, 0x0644}},
+  /* Stress cases: a single joined run, cursive-attached end to end, such that
+   * attachment chains span the whole buffer; time per glyph should not grow
+   * with the run. */
+  {"arabic-cursive-run-1000", IN_HOUSE "c4e48b0886ef460f532fb49f00047ec92c432ec0.ttf", BENCH_RUN, 1000,
+   {0x0643, 0x0645, 0x0645, 0x062B, 0x0644}},
+  {"arabic-cursive-run-10000", IN_HOUSE "c4e48b0886ef460f532fb49f00047ec92c432ec0.ttf", BENCH_RUN, 10000,
+   {0x0643, 0x0645, 0x0645, 0x062B, 0x0644}},
+  {"arabic-cursive-run-100000", IN_HOUSE "c4e48b0886ef460f532fb49f00047ec92c432ec0.ttf", BENCH_RUN, 100000,
+   {0x0643, 0x0645, 0x0645, 0x062B, 0x0644}},
+  {"hebrew-paragraph",	IN_HOUSE "43ef465752be9af900745f72fe29cb853a1401a5.ttf", BENCH_PARAGRAPH, 0,
+   {0x05D4, 0x05B7, 0x05E9, 0x05BC, 0x05C1, 0x05B8, 0x05DE, 0x05B4, 0x05DD}},
+  /* Stress cases: one base carrying a stack of marks, each searching back
+   * over the marks before it for the base; time per glyph should not grow
+   * with the stack. */
+  {"hebrew-mark-stack-100", IN_HOUSE "43ef465752be9af900745f72fe29cb853a1401a5.ttf", BENCH_STACK, 100,
+   {0x05D4, 0x05B7}},
+  {"hebrew-mark-stack-1000", IN_HOUSE "43ef465752be9af900745f72fe29cb853a1401a5.ttf", BENCH_STACK, 1000,
+   {0x05D4, 0x05B7}},
+  {"hebrew-mark-stack-10000", IN_HOUSE "43ef465752be9af900745f72fe29cb853a1401a5.ttf", BENCH_STACK, 10000,
+   {0x05D4, 0x05B7}},
+  {"devanagari-word",	IN_HOUSE "d629e7fedc0b350222d7987345fe61613fa3929a.ttf", BENCH_WORD, 0,
+   {0x0915, 0x093F, 0x0915, 0x093F}},
+  {"devanagari-paragraph", IN_HOUSE "d629e7fedc0b350222d7987345fe61613fa3929a.ttf", BENCH_PARAGRAPH, 0,
+   {0x0915, 0x093F, 0x0915, 0x093F}},
+  {"khmer-paragraph",	IN_HOUSE "3998336402905b8be8301ef7f47cf7e050cbb1bd.ttf", BENCH_PARAGRAPH, 0,
+   {0x1781, 0x17D2, 0x1798, 0x17C2, 0x1787, 0x17B6}},
+  {"myanmar-paragraph",	IN_HOUSE "af3086380b743099c54a3b11b96766039ea62fcd.ttf", BENCH_PARAGRAPH, 0,
+   {0x101D, 0xFE00, 0x1031, 0xFE00, 0x1031, 0xFE00}},
+  {"tibetan-paragraph",	IN_HOUSE "2de1ab4907ab688c0cfc236b0bf51151db38bf2e.ttf", BENCH_PARAGRAPH, 0,
+   {0x0F50, 0x0F74, 0x0F72, 0x0F53, 0x0F0B}},
+  {"thai-paragraph",	IN_HOUSE "45855bc8d46332b39c4ab9e2ee1a26b1f896da6b.ttf", BENCH_PARAGRAPH, 0,
+   {0x0E01, 0x0E34, 0x0E01}},
+  {"cham-paragraph",	IN_HOUSE "96490dd2ff81233b335a650e7eb660e0e7b2eeea.ttf", BENCH_PARAGRAPH, 0,
+   {0xAA00, 0xAA2D, 0xAA29}},
+  {"mongolian-paragraph", IN_HOUSE "4d4206e30b2dbf1c1ef492a8eae1c9e7829ebad8.ttf", BENCH_PARAGRAPH, 0,
+   {0x183A, 0x1823, 0x182E, 0x182B, 0x1822, 0x1826, 0x180B, 0x1832, 0x180B, 0x1827, 0x1837}},
+  {"hangul-paragraph",	IN_HOUSE "757ebd573617a24aa9dfbf0b885c54875c6fe06b.ttf", BENCH_PARAGRAPH, 0,
+   {0x115F, 0x11A2}},
+};
+
+#define PARAGRAPH_LENGTH 1000
+/* Roughly how many codepoints each timed round shapes. */
+#define ROUND_CODEPOINTS 200000
+
+/* Returns a newly allocated text, of *len codepoints. */
+static unsigned int *
+build_text (const bench_case_t *c, unsigned int *len)
+{
+  unsigned int word_len = 0;
+  while (word_len < ARRAY_LENGTH (c->text) && c->text[word_len])
+    word_len++;
+
+  unsigned int target = c->length == BENCH_PARAGRAPH ? PARAGRAPH_LENGTH :
+			c->length == BENCH_RUN || c->length == BENCH_STACK ? c->run_length :
+			word_len;
+  unsigned int *text = (unsigned int *) calloc (target + word_len + 1, sizeof (text[0]));
+  unsigned int first = 0;
+  *len = 0;
+  if (c->length == BENCH_STACK)
+    text[(*len)++] = c->text[first++];
+  do
+  {
+    if (*len && c->length == BENCH_PARAGRAPH)
+      text[(*len)++] = ' ';
+    for (unsigned int i = first; i < word_len; i++)
+      text[(*len)++] = c->text[i];
+  }
+  while (*len < target && first < word_len);
+  return text;
+}
+
+static void
+fill_buffer (hb_buffer_t *buffer, const unsigned int *text, unsigned int len)
+{
+  hb_buffer_clear_contents (buffer);
+  hb_buffer_add_codepoints (buffer, text, len, 0, len);
+  hb_buffer_guess_segment_properties (buffer);
+}
+
+static int
+cmp_uint64 (const void *pa, const void *pb)
+{
+  uint64_t a = * (const uint64_t *) pa;
+  uint64_t b = * (const uint64_t *) pb;
+  return a < b ? -1 : a > b ? +1 : 0;
+}
+
+static uint64_t
+median (uint64_t *samples, unsigned int count)
+{
+  qsort (samples, count, sizeof (samples[0]), cmp_uint64);
+  return samples[count / 2];
+}
+
+struct alloc_delta_t
+{
+  uint64_t allocs;
+  uint64_t bytes;
+  uint64_t peak;
+  uint64_t live;
+};
+
+static inline alloc_counters_t
+alloc_begin (void)
+{
+  alloc_counters_t start = counters;
+  counters.peak = counters.live;
+  return start;
+}
+
+static inline alloc_delta_t
+alloc_end (const alloc_counters_t &start)
+{
+  alloc_delta_t delta;
+  delta.allocs = counters.allocs - start.allocs;
+  delta.bytes = counters.bytes - start.bytes;
+  delta.peak = counters.peak - start.live;
+  delta.live = counters.live - start.live;
+  counters.peak = MAX (counters.peak, start.peak);
+  return delta;
+}
+
+static bool
+run_case (const bench_case_t *c, const char *srcdir, unsigned int rounds)
+{
+  char path[1024];
+  snprintf (path, sizeof (path), "%s/%s", srcdir, c->font);
+  hb_blob_t *blob = hb_blob_create_from_file (path);
+  if (!hb_blob_get_length (blob))
+  {
+    fprintf (stderr, "%s: cannot open %s\n", c->name, path);
+    hb_blob_destroy (blob);
+    return false;
+  }
+
+  unsigned int len;
+  unsigned int *text = build_text (c, &len);
+  unsigned int iterations = MAX (1u, ROUND_CODEPOINTS / len);
+  uint64_t *samples = (uint64_t *) calloc (rounds, sizeof (samples[0]));
+  hb_buffer_t *buffer = hb_buffer_create ();
+
+  /* Cold face: everything the first shaping call of a fresh face pays for,
+   * minus reading the file.  Allocation counts are the same every round but
+   * the first, which also grows the buffer; the last one is kept. */
+  alloc_delta_t cold = {0, 0, 0, 0};
+  for (unsigned int r = 0; r < rounds; r++)
+  {
+    fill_buffer (buffer, text, len);
+    alloc_counters_t alloc_start = alloc_begin ();
+    uint64_t start = _hb_time_ns ();
+    hb_face_t *face = hb_face_create (blob, 0);
+    hb_font_t *font = hb_font_create (face);
+    hb_shape (font, buffer, nullptr, 0);
+    samples[r] = _hb_time_ns () - start;
+    cold = alloc_end (alloc_start);
+    hb_font_destroy (font);
+    hb_face_destroy (face);
+  }
+  uint64_t cold_face_ns = median (samples, rounds);
+
+  hb_face_t *face = hb_face_create (blob, 0);
+  hb_font_t *font = hb_font_create (face);
+  fill_buffer (buffer, text, len);
+  hb_shape (font, buffer, nullptr, 0);
+  unsigned int glyphs = hb_buffer_get_length (buffer);
+
+  hb_segment_properties_t props;
+  fill_buffer (buffer, text, len);
+  hb_buffer_get_segment_properties (buffer, &props);
+
+  alloc_delta_t plan_alloc = {0, 0, 0, 0};
+  for (unsigned int r = 0; r < rounds; r++)
+  {
+    alloc_counters_t alloc_start = alloc_begin ();
+    uint64_t start = _hb_time_ns ();
+    hb_shape_plan_t *plan = hb_shape_plan_create (face, &props, nullptr, 0, nullptr);
+    samples[r] = _hb_time_ns () - start;
+    plan_alloc = alloc_end (alloc_start);
+    hb_shape_plan_destroy (plan);
+  }
+  uint64_t plan_ns = median (samples, rounds);
+
+  for (unsigned int r = 0; r < rounds; r++)
+  {
+    uint64_t start = _hb_time_ns ();
+    for (unsigned int i = 0; i < iterations; i++)
+    {
+      fill_buffer (buffer, text, len);
+      hb_shape (font, buffer, nullptr, 0);
+    }
+    samples[r] = _hb_time_ns () - start;
+  }
+  double ns_per_glyph = (double) median (samples, rounds) /
+			((double) iterations * MAX (1u, glyphs));
+
+  fill_buffer (buffer, text, len);
+  alloc_counters_t alloc_start = alloc_begin ();
+  hb_shape (font, buffer, nullptr, 0);
+  alloc_delta_t shape = alloc_end (alloc_start);
+
+  alloc_start = alloc_begin ();
+  hb_buffer_t *fresh = hb_buffer_create ();
+  fill_buffer (fresh, text, len);
+  hb_shape (font, fresh, nullptr, 0);
+  alloc_delta_t fresh_buffer = alloc_end (alloc_start);
+  hb_buffer_destroy (fresh);
+
+  char script[5];
+  hb_tag_to_string (hb_script_to_iso15924_tag (props.script), script);
+  script[4] = '\0';
+
+  printf ("%s\t%s\t%u\t%u\t%u\t%.2f\t%llu\t%llu\t"
+	  "%llu\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\n",
+	  c->name, script, len, glyphs, iterations,
+	  ns_per_glyph,
+	  (unsigned long long) plan_ns,
+	  (unsigned long long) cold_face_ns,
+	  (unsigned long long) shape.allocs,
+	  (unsigned long long) shape.bytes,
+	  (unsigned long long) plan_alloc.allocs,
+	  (unsigned long long) plan_alloc.bytes,
+	  (unsigned long long) cold.allocs,
+	  (unsigned long long) cold.bytes,
+	  (unsigned long long) cold.peak,
+	  (unsigned long long) cold.live,
+	  (unsigned long long) fresh_buffer.live);
+
+  hb_font_destroy (font);
+  hb_face_destroy (face);
+  hb_buffer_destroy (buffer);
+  hb_blob_destroy (blob);
+  free (samples);
+  free (text);
+  return true;
+}
+
+int
+main (int argc, char **argv)
+{
+  if (argc > 3) {
+    fprintf (stderr, "usage: %s [top-srcdir [rounds]]\n", argv[0]);
+    exit (1);
+  }
+
+  const char *srcdir = argc > 1 ? argv[1] : ".";
+  unsigned int rounds = argc > 2 ? MAX (1, atoi (argv[2])) : 5;
+
+  if (!_hb_time_ns ())
+  {
+    fprintf (stderr, "no monotonic clock available\n");
+    return 77;
+  }
+
+  printf ("#hb-shape-bench\t%d\n", BENCH_FORMAT_VERSION);
+  printf ("case\tscript\tcodepoints\tglyphs\titerations\tns_per_glyph\t"
+	  "plan_ns\tcold_face_ns\tshape_allocs\tshape_bytes\tplan_allocs\t"
+	  "plan_bytes\tcold_allocs\tcold_bytes\tcold_peak_bytes\tface_bytes\t"
+	  "buffer_bytes\n");
+
+  bool ret = true;
+  for (unsigned int i = 0; i < ARRAY_LENGTH (cases); i++)
+    ret = run_case (&cases[i], srcdir, rounds) && ret;
+
+  return !ret;
+}
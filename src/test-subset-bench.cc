@@ -0,0 +1,377 @@
+/*
+ * Copyright © 2026  Google, Inc.
+ *
+ *  This is part of HarfBuzz, a text shaping library.
+ *
+ * Permission is hereby granted, without written agreement and without
+ * license or royalty fees, to use, copy, modify, and distribute this
+ * software and its documentation for any purpose, provided that the
+ * above copyright notice and the following two paragraphs appear in
+ * all copies of this software.
+ *
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES
+ * ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN
+ * IF THE COPYRIGHT HOLDER HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * THE COPYRIGHT HOLDER SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING,
+ * BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE COPYRIGHT HOLDER HAS NO OBLIGATION TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ */
+
+#include "hb.hh"
+#include "hb-time.hh"
+#include "hb-bench-alloc.hh"
+#include "hb-subset.hh"
+
+#include "hb.h"
+#include "hb-ot.h"
+#include "hb-subset.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Subsetting benchmark.
+ *
+ * Subsets a matrix of fonts, from the subset and shaping test suites, to
+ * unicode sets of growing size, and prints one tab-separated line per case
+ * and phase.  The first line names the format and its version; the second
+ * one names the columns.  Columns are only ever appended, so scripts
+ * tracking regressions across commits can keep reading the ones they know
+ * about.
+ *
+ *   case            Name of the case; stable across versions.
+ *   unicodes        Size of the input unicode set.
+ *   glyphs          Number of glyphs retained.
+ *   phase           What is measured, one of:
+ *                     plan     hb_subset_plan_create(), GSUB closure included;
+ *                     closure  the GSUB closure alone;
+ *                     a tag    subsetting that table, against a ready plan;
+ *                     subset   hb_subset(), from start to end.
+ *   ns              Time taken.
+ *   allocs          Number of malloc(), calloc() and realloc() calls.
+ *   alloc_bytes     Bytes requested by those calls.
+ *   peak_bytes      Peak heap usage, above that at the start of the phase.
+ *   out_bytes       Size of the table produced, or of the whole font.
+ *
+ * Every round starts from a fresh face, such that nothing is cached from
+ * the previous one.  Times are the median over all rounds.
+ *
+ * This program links a copy of the library of its own, built with
+ * hb_malloc_impl and friends pointing to the counting allocator of
+ * hb-bench-alloc.hh.  Address space that serializers reserve and commit
+ * directly from the system is not seen by it; only the copy each table
+ * ends up in is.
+ */
+
+#define BENCH_FORMAT_VERSION 1
+
+#define SUBSET "test/subset/data/fonts/"
+#define TEXT_RENDERING "test/shaping/data/text-rendering-tests/fonts/"
+
+struct bench_font_t
+{
+  const char *name;
+  const char *font;
+};
+
+static const bench_font_t fonts[] =
+{
+  {"latin",	SUBSET "Roboto-Regular.ttf"},
+  {"cjk",	SUBSET "Mplus1p-Regular.ttf"},
+  {"kannada",	TEXT_RENDERING "NotoSansKannada-Regular.ttf"},
+  {"variable",	TEXT_RENDERING "Selawik-variable.ttf"},
+  /* 65535 glyphs, mapped from nearly all of Unicode. */
+  {"cff",	TEXT_RENDERING "FDArrayTest65535.otf"},
+};
+
+/* Unicode set sizes; zero stands for all the font maps. */
+static const unsigned int sizes[] = {10, 100, 1000, 10000, 0};
+
+
+/*
+ * Phases.
+ */
+
+struct phase_t
+{
+  char name[8];
+  uint64_t *samples;
+  uint64_t allocs;
+  uint64_t bytes;
+  uint64_t peak;
+  unsigned int out_bytes;
+
+  /* Set by begin (). */
+  uint64_t start_ns;
+  alloc_counters_t start;
+
+  inline void init (const char *name_, unsigned int rounds)
+  {
+    snprintf (name, sizeof (name), "%s", name_);
+    samples = (uint64_t *) calloc (rounds, sizeof (samples[0]));
+    allocs = bytes = peak = 0;
+    out_bytes = 0;
+  }
+
+  inline void fini (void) { free (samples); }
+
+  inline void begin (void)
+  {
+    start = counters;
+    counters.peak = counters.live;
+    start_ns = _hb_time_ns ();
+  }
+
+  /* Allocation counts are the same every round; the last one is kept. */
+  inline void end (unsigned int round)
+  {
+    samples[round] = _hb_time_ns () - start_ns;
+    allocs = counters.allocs - start.allocs;
+    bytes = counters.bytes - start.bytes;
+    peak = counters.peak - start.live;
+    counters.peak = MAX (counters.peak, start.peak);
+  }
+};
+
+static int
+cmp_uint64 (const void *pa, const void *pb)
+{
+  uint64_t a = * (const uint64_t *) pa;
+  uint64_t b = * (const uint64_t *) pb;
+  return a < b ? -1 : a > b ? +1 : 0;
+}
+
+static uint64_t
+median (uint64_t *samples, unsigned int count)
+{
+  qsort (samples, count, sizeof (samples[0]), cmp_uint64);
+  return samples[count / 2];
+}
+
+static unsigned int
+table_length (hb_face_t *face, hb_tag_t tag)
+{
+  hb_blob_t *blob = hb_face_reference_table (face, tag);
+  unsigned int length = hb_blob_get_length (blob);
+  hb_blob_destroy (blob);
+  return length;
+}
+
+/* The glyphs the plan starts the closure from. */
+static void
+collect_glyphs (hb_face_t *face, const hb_set_t *unicodes, hb_set_t *glyphs)
+{
+  hb_font_t *font = hb_font_create (face);
+  hb_set_add (glyphs, 0);
+  for (hb_codepoint_t u = HB_SET_VALUE_INVALID; hb_set_next (unicodes, &u);)
+  {
+    hb_codepoint_t gid;
+    if (hb_font_get_nominal_glyph (font, u, &gid))
+      hb_set_add (glyphs, gid);
+  }
+  hb_font_destroy (font);
+}
+
+static void
+run_case (const char *name, hb_blob_t *blob, hb_set_t *unicodes, unsigned int rounds)
+{
+  hb_subset_input_t *input = hb_subset_input_create_or_fail ();
+  hb_subset_input_set_drop_layout (input, false);
+  hb_set_union (hb_subset_input_unicode_set (input), unicodes);
+
+  /* Plan, closure and subset, and one phase per table kept. */
+  hb_face_t *face = hb_face_create (blob, 0);
+  unsigned int table_count = hb_face_get_table_tags (face, 0, nullptr, nullptr);
+  hb_tag_t *tags = (hb_tag_t *) calloc (MAX (1u, table_count), sizeof (tags[0]));
+  hb_face_get_table_tags (face, 0, &table_count, tags);
+  hb_face_destroy (face);
+
+  phase_t *phases = (phase_t *) calloc (table_count + 3, sizeof (phases[0]));
+  phase_t *plan_phase = &phases[0];
+  phase_t *table_phases = &phases[1];
+  phase_t *closure_phase = &phases[table_count + 1];
+  phase_t *subset_phase = &phases[table_count + 2];
+  plan_phase->init ("plan", rounds);
+  for (unsigned int i = 0; i < table_count; i++)
+  {
+    char tag[5];
+    hb_tag_to_string (tags[i], tag);
+    tag[4] = '\0';
+    table_phases[i].init (tag, rounds);
+  }
+  closure_phase->init ("closure", rounds);
+  subset_phase->init ("subset", rounds);
+
+  unsigned int glyphs = 0;
+  bool *kept = (bool *) calloc (MAX (1u, table_count), sizeof (kept[0]));
+  for (unsigned int r = 0; r < rounds; r++)
+  {
+    face = hb_face_create (blob, 0);
+
+    plan_phase->begin ();
+    hb_subset_plan_t *plan = hb_subset_plan_create (face, input);
+    plan_phase->end (r);
+    glyphs = plan->glyphs.len;
+
+    for (unsigned int i = 0; i < table_count; i++)
+    {
+      kept[i] = !hb_subset_should_drop_table (plan, tags[i]);
+      if (!kept[i])
+	continue;
+      table_phases[i].begin ();
+      hb_subset_table (plan, tags[i]);
+      table_phases[i].end (r);
+    }
+    /* Some tables are written along with others; glyf writes loca. */
+    for (unsigned int i = 0; i < table_count; i++)
+      table_phases[i].out_bytes = table_length (plan->dest, tags[i]);
+
+    hb_subset_plan_destroy (plan);
+    hb_face_destroy (face);
+  }
+
+  for (unsigned int r = 0; r < rounds; r++)
+  {
+    face = hb_face_create (blob, 0);
+    hb_set_t *closure = hb_set_create ();
+    collect_glyphs (face, unicodes, closure);
+
+    closure_phase->begin ();
+    hb_set_t *lookups = hb_set_create ();
+    hb_ot_layout_collect_lookups (face, HB_OT_TAG_GSUB, nullptr, nullptr, nullptr, lookups);
+    hb_ot_layout_lookups_substitute_closure (face, lookups, closure);
+    hb_set_destroy (lookups);
+    closure_phase->end (r);
+
+    hb_set_destroy (closure);
+    hb_face_destroy (face);
+  }
+
+  for (unsigned int r = 0; r < rounds; r++)
+  {
+    face = hb_face_create (blob, 0);
+
+    subset_phase->begin ();
+    hb_face_t *result = hb_subset (face, input);
+    subset_phase->end (r);
+
+    hb_blob_t *result_blob = hb_face_reference_blob (result);
+    subset_phase->out_bytes = hb_blob_get_length (result_blob);
+    hb_blob_destroy (result_blob);
+    hb_face_destroy (result);
+    hb_face_destroy (face);
+  }
+
+  for (unsigned int i = 0; i < table_count + 3; i++)
+  {
+    phase_t *phase = &phases[i];
+    if (phase >= table_phases && phase < closure_phase && !kept[phase - table_phases])
+      continue;
+    printf ("%s\t%u\t%u\t%s\t%llu\t%llu\t%llu\t%llu\t%u\n",
+	    name, hb_set_get_population (unicodes), glyphs, phase->name,
+	    (unsigned long long) median (phase->samples, rounds),
+	    (unsigned long long) phase->allocs,
+	    (unsigned long long) phase->bytes,
+	    (unsigned long long) phase->peak,
+	    phase->out_bytes);
+  }
+
+  for (unsigned int i = 0; i < table_count + 3; i++)
+    phases[i].fini ();
+  free (phases);
+  free (kept);
+  free (tags);
+  hb_subset_input_destroy (input);
+}
+
+static bool
+run_font (const char *font_name, const char *path, unsigned int rounds)
+{
+  hb_blob_t *blob = hb_blob_create_from_file (path);
+  if (!hb_blob_get_length (blob))
+  {
+    fprintf (stderr, "%s: cannot open %s\n", font_name, path);
+    hb_blob_destroy (blob);
+    return false;
+  }
+
+  hb_face_t *face = hb_face_create (blob, 0);
+  hb_set_t *all = hb_set_create ();
+  hb_face_collect_unicodes (face, all);
+  hb_face_destroy (face);
+  unsigned int population = hb_set_get_population (all);
+
+  /* Spread each set evenly over what the font maps. */
+  hb_set_t *unicodes = hb_set_create ();
+  for (unsigned int i = 0; i < ARRAY_LENGTH (sizes); i++)
+  {
+    unsigned int size = sizes[i];
+    if (size && size >= population)
+      continue;
+
+    char name[64];
+    if (size)
+      snprintf (name, sizeof (name), "%s-%u", font_name, size);
+    else
+      snprintf (name, sizeof (name), "%s-all", font_name);
+
+    hb_set_clear (unicodes);
+    unsigned int n = 0;
+    for (hb_codepoint_t u = HB_SET_VALUE_INVALID; hb_set_next (all, &u); n++)
+      if (!size || (uint64_t) n * size / population != (uint64_t) (n + 1) * size / population)
+	hb_set_add (unicodes, u);
+
+    run_case (name, blob, unicodes, rounds);
+  }
+
+  hb_set_destroy (unicodes);
+  hb_set_destroy (all);
+  hb_blob_destroy (blob);
+  return true;
+}
+
+int
+main (int argc, char **argv)
+{
+  if (argc > 1 && argv[1][0] == '-') {
+    fprintf (stderr, "usage: %s [top-srcdir [rounds [font-file...]]]\n", argv[0]);
+    exit (1);
+  }
+
+  const char *srcdir = argc > 1 ? argv[1] : ".";
+  unsigned int rounds = argc > 2 ? MAX (1, atoi (argv[2])) : 5;
+
+  if (!_hb_time_ns ())
+  {
+    fprintf (stderr, "no monotonic clock available\n");
+    return 77;
+  }
+
+  printf ("#hb-subset-bench\t%d\n", BENCH_FORMAT_VERSION);
+  printf ("case\tunicodes\tglyphs\tphase\tns\tallocs\talloc_bytes\t"
+	  "peak_bytes\tout_bytes\n");
+
+  bool ret = true;
+  for (unsigned int i = 0; i < ARRAY_LENGTH (fonts); i++)
+  {
+    char path[1024];
+    snprintf (path, sizeof (path), "%s/%s", srcdir, fonts[i].font);
+    ret = run_font (fonts[i].name, path, rounds) && ret;
+  }
+
+  /* Fonts too large to ship, such as full CJK ones, are named on the
+   * command line; their cases are named after the file. */
+  for (int i = 3; i < argc; i++)
+  {
+    const char *base = strrchr (argv[i], '/');
+    ret = run_font (base ? base + 1 : argv[i], argv[i], rounds) && ret;
+  }
+
+  return !ret;
+}
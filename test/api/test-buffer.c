@@ -25,6 +25,7 @@
  */
 
 #include "hb-test.h"
+#include "hb-subset-test.h"
 
 /* Unit tests for hb-buffer.h */
 
@@ -329,6 +330,16 @@ test_buffer_allocation (fixture_t *fixture, gconstpointer user_data HB_UNUSED)
   g_assert_cmpint (hb_buffer_get_length (b), ==, 0);
   g_assert (hb_buffer_allocation_successful (b));
 
+  {
+    hb_memory_usage_t usage[4];
+    unsigned int usage_count = G_N_ELEMENTS (usage);
+    unsigned int total = hb_buffer_get_memory_usage (b, &usage_count, usage);
+    g_assert_cmpuint (3, ==, usage_count);
+    g_assert_cmpuint (HB_MEMORY_USAGE_GLYPH_INFOS, ==, usage[1].subsystem);
+    g_assert_cmpuint (100 * sizeof (hb_glyph_info_t), <=, usage[1].bytes);
+    g_assert_cmpuint (total, ==, usage[0].bytes + usage[1].bytes + usage[2].bytes);
+  }
+
   /* lets try a huge allocation, make sure it fails */
   g_assert (!hb_buffer_pre_allocate (b, (unsigned int) -1));
   g_assert_cmpint (hb_buffer_get_length (b), ==, 0);
@@ -819,6 +830,57 @@ test_empty (hb_buffer_t *b)
   g_assert (!hb_buffer_get_glyph_positions (b, NULL));
 }
 
+#ifndef HB_NO_BUFFER_COUNTERS
+static void
+test_buffer_counters (void)
+{
+  hb_face_t *face = hb_subset_test_open_font ("fonts/Roboto-Regular.gsub.fi.ttf");
+  hb_font_t *font = hb_font_create (face);
+  hb_buffer_t *b = hb_buffer_create ();
+  hb_buffer_lookup_counters_t counters[4];
+  unsigned int counters_count = G_N_ELEMENTS (counters);
+  unsigned int lookup_count;
+
+  hb_buffer_add_utf8 (b, "fi", -1, 0, -1);
+  hb_buffer_guess_segment_properties (b);
+  hb_shape (font, b, NULL, 0);
+  g_assert_cmpuint (0, ==, hb_buffer_get_lookup_counters (b, HB_TAG ('G','S','U','B'), 0, NULL, NULL));
+
+  hb_buffer_clear_contents (b);
+  hb_buffer_set_flags (b, HB_BUFFER_FLAG_COLLECT_COUNTERS);
+  hb_buffer_add_utf8 (b, "fi", -1, 0, -1);
+  hb_buffer_guess_segment_properties (b);
+  hb_shape (font, b, NULL, 0);
+  g_assert_cmpuint (1, ==, hb_buffer_get_length (b));
+
+  /* The font has a single GSUB lookup, forming the ligature. */
+  lookup_count = hb_buffer_get_lookup_counters (b, HB_TAG ('G','S','U','B'), 0, &counters_count, counters);
+  g_assert_cmpuint (1, ==, lookup_count);
+  g_assert_cmpuint (1, ==, counters_count);
+  g_assert_cmpuint (HB_TAG ('G','S','U','B'), ==, counters[0].table_tag);
+  g_assert_cmpuint (0, ==, counters[0].lookup_index);
+  g_assert_cmpuint (1, ==, counters[0].visits);
+  g_assert_cmpuint (1, ==, counters[0].applies);
+  g_assert_cmpuint (1, <=, counters[0].subtables_tried);
+  g_assert_cmpuint (0, ==, counters[0].glyphs_inserted);
+  g_assert_cmpuint (1, ==, counters[0].glyphs_removed);
+  g_assert_cmpuint (0, ==, hb_buffer_get_decomposition_count (b));
+
+  counters_count = G_N_ELEMENTS (counters);
+  g_assert_cmpuint (1, ==, hb_buffer_get_lookup_counters (b, HB_TAG ('G','S','U','B'), 1, &counters_count, counters));
+  g_assert_cmpuint (0, ==, counters_count);
+  g_assert_cmpuint (0, ==, hb_buffer_get_lookup_counters (b, HB_TAG ('k','e','r','n'), 0, NULL, NULL));
+
+  /* Cleared with the contents. */
+  hb_buffer_clear_contents (b);
+  g_assert_cmpuint (0, ==, hb_buffer_get_lookup_counters (b, HB_TAG ('G','S','U','B'), 0, NULL, NULL));
+
+  hb_buffer_destroy (b);
+  hb_font_destroy (font);
+  hb_face_destroy (face);
+}
+#endif
+
 static void
 test_buffer_empty (void)
 {
@@ -878,6 +940,9 @@ main (int argc, char **argv)
   hb_test_add (test_buffer_utf8_validity);
   hb_test_add (test_buffer_utf16_conversion);
   hb_test_add (test_buffer_utf32_conversion);
+#ifndef HB_NO_BUFFER_COUNTERS
+  hb_test_add (test_buffer_counters);
+#endif
   hb_test_add (test_buffer_empty);
 
   return hb_test_run();
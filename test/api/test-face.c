@@ -0,0 +1,233 @@
+/*
+ * Copyright © 2026  Google, Inc.
+ *
+ *  This is part of HarfBuzz, a text shaping library.
+ *
+ * Permission is hereby granted, without written agreement and without
+ * license or royalty fees, to use, copy, modify, and distribute this
+ * software and its documentation for any purpose, provided that the
+ * above copyright notice and the following two paragraphs appear in
+ * all copies of this software.
+ *
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE TO ANY PARTY FOR
+ * DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES
+ * ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN
+ * IF THE COPYRIGHT HOLDER HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * THE COPYRIGHT HOLDER SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING,
+ * BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ * ON AN "AS IS" BASIS, AND THE COPYRIGHT HOLDER HAS NO OBLIGATION TO
+ * PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+ */
+
+#include "hb-test.h"
+#include "hb-subset-test.h"
+
+/* Unit tests for hb-face.h */
+
+static void
+shape_fi (hb_face_t *face, hb_codepoint_t *glyph, unsigned int *count)
+{
+  hb_font_t *font = hb_font_create (face);
+  hb_buffer_t *buffer = hb_buffer_create ();
+  hb_glyph_info_t *info;
+  unsigned int i;
+
+  hb_buffer_add_utf8 (buffer, "fi", -1, 0, -1);
+  hb_buffer_guess_segment_properties (buffer);
+  hb_shape (font, buffer, NULL, 0);
+
+  info = hb_buffer_get_glyph_infos (buffer, count);
+  for (i = 0; i < *count; i++)
+    glyph[i] = info[i].codepoint;
+
+  hb_buffer_destroy (buffer);
+  hb_font_destroy (font);
+}
+
+static void
+test_face_trusted_tables (void)
+{
+  hb_face_t *face = hb_subset_test_open_font ("fonts/Roboto-Regular.gsub.fi.ttf");
+  hb_face_t *trusted_face = hb_subset_test_open_font ("fonts/Roboto-Regular.gsub.fi.ttf");
+  hb_face_table_digest_t digests[32];
+  unsigned int digests_count = G_N_ELEMENTS (digests);
+  hb_codepoint_t glyphs[2], trusted_glyphs[2];
+  unsigned int glyphs_count, trusted_glyphs_count;
+
+  /* Nothing is recorded outside trusted-tables mode. */
+  shape_fi (face, glyphs, &glyphs_count);
+  g_assert_cmpuint (0, ==, hb_face_get_sanitized_tables (face, 0, NULL, NULL));
+  hb_face_destroy (face);
+
+  /* Record the tables that pass sanitization... */
+  face = hb_subset_test_open_font ("fonts/Roboto-Regular.gsub.fi.ttf");
+  g_assert (hb_face_set_trusted_tables (face, NULL, 0));
+  shape_fi (face, glyphs, &glyphs_count);
+  g_assert_cmpuint (1, ==, glyphs_count);
+  g_assert_cmpuint (0, <, hb_face_get_sanitized_tables (face, 0, &digests_count, digests));
+  g_assert_cmpuint (0, <, digests_count);
+
+  /* ...and trust them on another face of the same font. */
+  g_assert (hb_face_set_trusted_tables (trusted_face, digests, digests_count));
+  shape_fi (trusted_face, trusted_glyphs, &trusted_glyphs_count);
+  g_assert_cmpuint (glyphs_count, ==, trusted_glyphs_count);
+  g_assert_cmpuint (glyphs[0], ==, trusted_glyphs[0]);
+  g_assert_cmpuint (0, ==, hb_face_get_sanitized_tables (trusted_face, 0, NULL, NULL));
+
+  /* A digest that does not match is not trusted. */
+  hb_face_destroy (trusted_face);
+  trusted_face = hb_subset_test_open_font ("fonts/Roboto-Regular.gsub.fi.ttf");
+  digests[0].checksum++;
+  g_assert (hb_face_set_trusted_tables (trusted_face, digests, digests_count));
+  shape_fi (trusted_face, trusted_glyphs, &trusted_glyphs_count);
+  g_assert_cmpuint (1, ==, hb_face_get_sanitized_tables (trusted_face, 0, &digests_count, digests));
+  g_assert_cmpuint (1, ==, digests_count);
+
+  hb_face_destroy (trusted_face);
+  hb_face_destroy (face);
+}
+
+static void
+reverse_runner (hb_face_task_func_t  task_func,
+		void                *task_data,
+		unsigned int         task_count,
+		void                *user_data)
+{
+  unsigned int *total = (unsigned int *) user_data;
+  unsigned int i;
+
+  for (i = task_count; i; i--)
+    task_func (task_data, i - 1);
+  *total += task_count;
+}
+
+static void
+test_face_prewarm (void)
+{
+  hb_face_t *face = hb_subset_test_open_font ("fonts/Roboto-Regular.gsub.fi.ttf");
+  hb_face_prewarm_part_t parts[8];
+  unsigned int parts_count = 1;
+  unsigned int i;
+
+  /* Reports are truncated to the array, but every part is prewarmed. */
+  g_assert_cmpuint (2, ==, hb_face_prewarm (face, (hb_face_prewarm_flags_t) (HB_FACE_PREWARM_FLAG_CMAP | HB_FACE_PREWARM_FLAG_GSUB), &parts_count, parts));
+  g_assert_cmpuint (1, ==, parts_count);
+  g_assert_cmpuint (HB_FACE_PREWARM_FLAG_CMAP, ==, parts[0].part);
+
+  parts_count = G_N_ELEMENTS (parts);
+  g_assert_cmpuint (8, ==, hb_face_prewarm (face, HB_FACE_PREWARM_FLAG_ALL, &parts_count, parts));
+  g_assert_cmpuint (8, ==, parts_count);
+  for (i = 0; i < parts_count; i++)
+  {
+    g_assert_cmpuint (1u << i, ==, parts[i].part);
+    g_assert_cmpuint (0, <, parts[i].bytes);
+  }
+
+  g_assert_cmpuint (1, ==, hb_face_prewarm (face, HB_FACE_PREWARM_FLAG_POST, NULL, NULL));
+
+  hb_face_destroy (face);
+}
+
+static unsigned int
+get_usage (const hb_memory_usage_t *usage, unsigned int usage_count, hb_tag_t subsystem)
+{
+  unsigned int i;
+  for (i = 0; i < usage_count; i++)
+    if (usage[i].subsystem == subsystem)
+      return usage[i].bytes;
+  return 0;
+}
+
+static void
+test_face_memory_usage (void)
+{
+  hb_face_t *face = hb_subset_test_open_font ("fonts/Roboto-Regular.gsub.fi.ttf");
+  hb_font_t *font;
+  hb_buffer_t *buffer;
+  hb_shape_plan_t *plan;
+  hb_segment_properties_t props;
+  hb_memory_usage_t usage[16];
+  unsigned int usage_count = G_N_ELEMENTS (usage);
+  unsigned int cold, warm;
+  hb_codepoint_t glyphs[2];
+  unsigned int glyphs_count;
+
+  cold = hb_face_get_memory_usage (face, NULL, NULL);
+  g_assert_cmpuint (0, <, cold);
+  g_assert_cmpuint (0, ==, hb_face_get_memory_usage (hb_face_get_empty (), NULL, NULL));
+
+  shape_fi (face, glyphs, &glyphs_count);
+  warm = hb_face_get_memory_usage (face, &usage_count, usage);
+  g_assert_cmpuint (cold, <, warm);
+  g_assert_cmpuint (0, <, get_usage (usage, usage_count, HB_TAG ('G','S','U','B')));
+  g_assert_cmpuint (0, <, get_usage (usage, usage_count, HB_MEMORY_USAGE_SHAPE_PLANS));
+
+  /* Reports are merged per subsystem, and the total does not depend on
+   * how many fit. */
+  usage_count = 1;
+  g_assert_cmpuint (warm, ==, hb_face_get_memory_usage (face, &usage_count, usage));
+  g_assert_cmpuint (1, ==, usage_count);
+  g_assert_cmpuint (HB_MEMORY_USAGE_OBJECT, ==, usage[0].subsystem);
+
+  font = hb_font_create (face);
+  g_assert_cmpuint (0, <, hb_font_get_memory_usage (font, NULL, NULL));
+  buffer = hb_buffer_create ();
+  hb_buffer_add_utf8 (buffer, "fi", 2, 0, 2);
+  hb_buffer_guess_segment_properties (buffer);
+  hb_buffer_get_segment_properties (buffer, &props);
+  plan = hb_shape_plan_create_cached (face, &props, NULL, 0, NULL);
+  g_assert_cmpuint (0, <, hb_shape_plan_get_memory_usage (plan, NULL, NULL));
+
+  /* Dropped caches are built again as needed. */
+  hb_face_drop_caches (face);
+  g_assert_cmpuint (warm, >, hb_face_get_memory_usage (face, NULL, NULL));
+  shape_fi (face, glyphs, &glyphs_count);
+  g_assert_cmpuint (1, ==, glyphs_count);
+  g_assert_cmpuint (warm, ==, hb_face_get_memory_usage (face, NULL, NULL));
+
+  hb_shape_plan_destroy (plan);
+  hb_buffer_destroy (buffer);
+  hb_font_destroy (font);
+  hb_face_destroy (face);
+}
+
+static void
+test_face_prewarm_parallel (void)
+{
+  hb_face_t *face = hb_subset_test_open_font ("fonts/Roboto-Regular.gsub.fi.ttf");
+  hb_face_t *cold_face = hb_subset_test_open_font ("fonts/Roboto-Regular.gsub.fi.ttf");
+  hb_codepoint_t glyphs[2], cold_glyphs[2];
+  unsigned int glyphs_count, cold_glyphs_count;
+  unsigned int total = 0;
+
+  hb_face_prewarm_parallel (face, HB_FACE_PREWARM_FLAG_ALL, reverse_runner, &total);
+  g_assert_cmpuint (8, <, total); /* One task per part, plus GSUB lookups. */
+
+  /* Running serially, and again, is fine. */
+  hb_face_prewarm_parallel (face, HB_FACE_PREWARM_FLAG_ALL, NULL, NULL);
+
+  shape_fi (face, glyphs, &glyphs_count);
+  shape_fi (cold_face, cold_glyphs, &cold_glyphs_count);
+  g_assert_cmpuint (1, ==, glyphs_count);
+  g_assert_cmpuint (cold_glyphs_count, ==, glyphs_count);
+  g_assert_cmpuint (cold_glyphs[0], ==, glyphs[0]);
+
+  hb_face_destroy (cold_face);
+  hb_face_destroy (face);
+}
+
+int
+main (int argc, char **argv)
+{
+  hb_test_init (&argc, &argv);
+
+  hb_test_add (test_face_trusted_tables);
+  hb_test_add (test_face_prewarm);
+  hb_test_add (test_face_prewarm_parallel);
+  hb_test_add (test_face_memory_usage);
+
+  return hb_test_run();
+}
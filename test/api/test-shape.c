@@ -180,6 +180,84 @@ test_shape_clusters (void)
 }
 
 
+typedef struct {
+  const char *open_stages[16];
+  unsigned int depth;
+  unsigned int events;
+  unsigned int kern_events;
+  uint64_t last_timestamp;
+} trace_state_t;
+
+static void
+trace_func (hb_buffer_t             *buffer HB_UNUSED,
+	    hb_font_t               *font HB_UNUSED,
+	    hb_buffer_trace_event_t  event,
+	    const char              *stage,
+	    unsigned int             stage_index HB_UNUSED,
+	    uint64_t                 timestamp,
+	    void                    *user_data)
+{
+  trace_state_t *state = (trace_state_t *) user_data;
+
+  if (!state->events)
+    g_assert_cmpstr (stage, ==, "shape");
+  g_assert_cmpuint (state->last_timestamp, <=, timestamp);
+  state->last_timestamp = timestamp;
+  state->events++;
+  if (!strcmp (stage, "fallback-kern"))
+    state->kern_events++;
+
+  /* Stages nest. */
+  if (event == HB_BUFFER_TRACE_EVENT_BEGIN)
+  {
+    g_assert_cmpuint (state->depth, <, G_N_ELEMENTS (state->open_stages));
+    state->open_stages[state->depth++] = stage;
+  }
+  else
+  {
+    g_assert_cmpuint (state->depth, >, 0);
+    g_assert_cmpstr (state->open_stages[--state->depth], ==, stage);
+  }
+}
+
+static void
+test_shape_trace (void)
+{
+  hb_face_t *face = hb_face_create (NULL, 0);
+  hb_font_t *font = hb_font_create (face);
+  hb_buffer_t *buffer = hb_buffer_create ();
+  trace_state_t state = {{0}};
+  hb_font_funcs_t *ffuncs;
+
+  ffuncs = hb_font_funcs_create ();
+  hb_font_funcs_set_nominal_glyph_func (ffuncs, glyph_func, NULL, NULL);
+  hb_font_funcs_set_glyph_h_kerning_func (ffuncs, glyph_h_kerning_func, NULL, NULL);
+  hb_font_set_funcs (font, ffuncs, NULL, NULL);
+  hb_font_funcs_destroy (ffuncs);
+
+  hb_buffer_set_trace_func (buffer, trace_func, &state, NULL);
+  hb_buffer_set_direction (buffer, HB_DIRECTION_LTR);
+  hb_buffer_add_utf8 (buffer, TesT, 4, 0, 4);
+  hb_shape (font, buffer, NULL, 0);
+
+  g_assert_cmpuint (0, ==, state.depth);
+  g_assert_cmpuint (2, <, state.events);
+  g_assert_cmpuint (2, ==, state.kern_events);
+
+  /* Not called any more once unset. */
+  hb_buffer_set_trace_func (buffer, NULL, NULL, NULL);
+  state.events = 0;
+  hb_buffer_clear_contents (buffer);
+  hb_buffer_set_direction (buffer, HB_DIRECTION_LTR);
+  hb_buffer_add_utf8 (buffer, TesT, 4, 0, 4);
+  hb_shape (font, buffer, NULL, 0);
+  g_assert_cmpuint (0, ==, state.events);
+
+  hb_buffer_destroy (buffer);
+  hb_font_destroy (font);
+  hb_face_destroy (face);
+}
+
 static void
 test_shape_list (void)
 {
@@ -200,6 +278,7 @@ main (int argc, char **argv)
 
   hb_test_add (test_shape);
   hb_test_add (test_shape_clusters);
+  hb_test_add (test_shape_trace);
   /* TODO test fallback shaper */
   /* TODO test shaper_full */
   hb_test_add (test_shape_list);
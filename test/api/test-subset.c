@@ -26,6 +26,7 @@
 
 #include "hb-test.h"
 #include "hb-subset-test.h"
+#include "hb-ot.h"
 
 /* Unit tests for hb-subset-glyf.h */
 
@@ -95,6 +96,536 @@ test_subset_crash (void)
   hb_face_destroy (face);
 }
 
+static void
+reverse_runner (hb_face_task_func_t  task_func,
+		void                *task_data,
+		unsigned int         task_count,
+		void                *user_data)
+{
+  unsigned int *total = (unsigned int *) user_data;
+  unsigned int i;
+
+  for (i = task_count; i; i--)
+    task_func (task_data, i - 1);
+  *total += task_count;
+}
+
+static void
+test_subset_parallel (void)
+{
+  hb_face_t *face = hb_subset_test_open_font ("fonts/Roboto-Regular.abc.ttf");
+  hb_face_t *broken = hb_subset_test_open_font ("fonts/crash-4b60576767ee4d9fe1cc10959d89baf73d4e8249");
+
+  hb_subset_input_t *input = hb_subset_input_create_or_fail ();
+  hb_set_t *codepoints = hb_subset_input_unicode_set (input);
+  hb_face_t *serial, *parallel;
+  hb_blob_t *serial_blob, *parallel_blob;
+  unsigned int total = 0;
+
+  hb_set_add (codepoints, 'a');
+  hb_set_add (codepoints, 'c');
+
+  serial = hb_subset (face, input);
+  parallel = hb_subset_parallel (face, input, reverse_runner, &total);
+  g_assert (parallel != hb_face_get_empty ());
+  g_assert_cmpuint (0, <, total);
+
+  /* Tables are assembled in the same order, whichever order they were
+   * subset in. */
+  serial_blob = hb_face_reference_blob (serial);
+  parallel_blob = hb_face_reference_blob (parallel);
+  hb_test_assert_blobs_equal (serial_blob, parallel_blob);
+  hb_blob_destroy (serial_blob);
+  hb_blob_destroy (parallel_blob);
+  hb_face_destroy (serial);
+  hb_face_destroy (parallel);
+
+  parallel = hb_subset_parallel (face, input, NULL, NULL);
+  g_assert (parallel != hb_face_get_empty ());
+  hb_face_destroy (parallel);
+
+  parallel = hb_subset_parallel (broken, input, reverse_runner, &total);
+  g_assert (parallel == hb_face_get_empty ());
+
+  hb_subset_input_destroy (input);
+  hb_face_destroy (broken);
+  hb_face_destroy (face);
+}
+
+static hb_blob_t *
+subset_blob (hb_face_t *face, const char *text)
+{
+  hb_subset_input_t *input = hb_subset_input_create_or_fail ();
+  hb_face_t *subset;
+  hb_blob_t *blob;
+
+  hb_subset_input_set_drop_layout (input, false);
+  for (; *text; text++)
+    hb_set_add (hb_subset_input_unicode_set (input), *text);
+  subset = hb_subset (face, input);
+  blob = hb_face_reference_blob (subset);
+
+  hb_face_destroy (subset);
+  hb_subset_input_destroy (input);
+  return blob;
+}
+
+static void
+test_subset_closure_cache (void)
+{
+  const char *fonts[] = {"fonts/Roboto-Regular.components.ttf",
+			 "fonts/Roboto-Regular.gsub.fil.ttf"};
+  const char *texts[] = {"fi", "il", "fil", "fi", "abc", "1fc", "il", "fil"};
+  unsigned int i, j;
+
+  /* Subsetting the same face repeatedly, for overlapping and repeated
+   * inputs, matches subsetting fresh faces. */
+  for (i = 0; i < G_N_ELEMENTS (fonts); i++)
+  {
+    hb_face_t *face = hb_subset_test_open_font (fonts[i]);
+    for (j = 0; j < G_N_ELEMENTS (texts); j++)
+    {
+      hb_face_t *fresh = hb_subset_test_open_font (fonts[i]);
+      hb_blob_t *expected = subset_blob (fresh, texts[j]);
+      hb_blob_t *actual = subset_blob (face, texts[j]);
+      hb_test_assert_blobs_equal (expected, actual);
+      hb_blob_destroy (expected);
+      hb_blob_destroy (actual);
+      hb_face_destroy (fresh);
+    }
+    hb_face_destroy (face);
+  }
+}
+
+static unsigned int
+closure_cache_usage (hb_face_t *face)
+{
+  hb_memory_usage_t usage[16];
+  unsigned int count = G_N_ELEMENTS (usage);
+  unsigned int i;
+
+  hb_face_get_memory_usage (face, &count, usage);
+  for (i = 0; i < count; i++)
+    if (usage[i].subsystem == HB_MEMORY_USAGE_SUBSET_CLOSURES)
+      return usage[i].bytes;
+  return 0;
+}
+
+static void
+test_subset_closure_cache_drop (void)
+{
+  hb_face_t *face = hb_subset_test_open_font ("fonts/Roboto-Regular.components.ttf");
+  hb_blob_t *expected, *actual;
+
+  /* The cache is reported, and dropped, with the other caches of the
+   * face; subsetting afterwards builds it again. */
+  g_assert_cmpuint (0, ==, closure_cache_usage (face));
+  expected = subset_blob (face, "fi");
+  g_assert_cmpuint (0, <, closure_cache_usage (face));
+
+  hb_face_drop_caches (face);
+  g_assert_cmpuint (0, ==, closure_cache_usage (face));
+
+  actual = subset_blob (face, "fi");
+  g_assert_cmpuint (0, <, closure_cache_usage (face));
+  hb_test_assert_blobs_equal (expected, actual);
+
+  hb_blob_destroy (expected);
+  hb_blob_destroy (actual);
+  hb_face_destroy (face);
+}
+
+static void
+test_subset_batch (void)
+{
+  hb_face_t *face = hb_subset_test_open_font ("fonts/Roboto-Regular.gsub.fil.ttf");
+  const char *texts[] = {"fi", "l", "fil", "abc"};
+  hb_subset_input_t *inputs[G_N_ELEMENTS (texts)];
+  hb_face_t *subsets[G_N_ELEMENTS (texts)];
+  unsigned int total = 0;
+  unsigned int i;
+
+  for (i = 0; i < G_N_ELEMENTS (texts); i++)
+  {
+    const char *text;
+    inputs[i] = hb_subset_input_create_or_fail ();
+    hb_subset_input_set_drop_layout (inputs[i], i % 2);
+    for (text = texts[i]; *text; text++)
+      hb_set_add (hb_subset_input_unicode_set (inputs[i]), *text);
+  }
+
+  hb_subset_batch (face, inputs, G_N_ELEMENTS (texts), subsets, reverse_runner, &total);
+  g_assert_cmpuint (G_N_ELEMENTS (texts), ==, total);
+
+  /* Each matches its own hb_subset(). */
+  for (i = 0; i < G_N_ELEMENTS (texts); i++)
+  {
+    hb_face_t *expected = hb_subset (face, inputs[i]);
+    hb_blob_t *expected_blob = hb_face_reference_blob (expected);
+    hb_blob_t *actual_blob = hb_face_reference_blob (subsets[i]);
+    g_assert (subsets[i] != hb_face_get_empty ());
+    hb_test_assert_blobs_equal (expected_blob, actual_blob);
+    hb_blob_destroy (expected_blob);
+    hb_blob_destroy (actual_blob);
+    hb_face_destroy (expected);
+    hb_face_destroy (subsets[i]);
+  }
+
+  hb_subset_batch (face, inputs, G_N_ELEMENTS (texts), subsets, NULL, NULL);
+  for (i = 0; i < G_N_ELEMENTS (texts); i++)
+  {
+    g_assert (subsets[i] != hb_face_get_empty ());
+    hb_face_destroy (subsets[i]);
+  }
+
+  /* No source, no subsets. */
+  hb_subset_batch (NULL, inputs, G_N_ELEMENTS (texts), subsets, NULL, NULL);
+  for (i = 0; i < G_N_ELEMENTS (texts); i++)
+  {
+    g_assert (subsets[i] == hb_face_get_empty ());
+    hb_subset_input_destroy (inputs[i]);
+  }
+
+  hb_face_destroy (face);
+}
+
+static void
+test_subset_batch_trusted (void)
+{
+  hb_face_t *face = hb_subset_test_open_font ("fonts/Roboto-Regular.gsub.fil.ttf");
+  hb_subset_input_t *input = hb_subset_input_create_or_fail ();
+  hb_face_t *subset;
+  hb_face_table_digest_t digests[32];
+  unsigned int digests_count;
+  unsigned int i;
+
+  hb_set_add (hb_subset_input_unicode_set (input), 'f');
+  g_assert (hb_face_set_trusted_tables (face, NULL, 0));
+
+  /* Tables sanitized by the batch are recorded on the source. */
+  hb_subset_batch (face, &input, 1, &subset, NULL, NULL);
+  g_assert (subset != hb_face_get_empty ());
+  digests_count = hb_face_get_sanitized_tables (face, 0, NULL, NULL);
+  g_assert_cmpuint (digests_count, <=, G_N_ELEMENTS (digests));
+  hb_face_get_sanitized_tables (face, 0, &digests_count, digests);
+  for (i = 0; i < digests_count; i++)
+    if (digests[i].tag == HB_TAG ('g','l','y','f'))
+      break;
+  g_assert_cmpuint (i, <, digests_count);
+
+  hb_face_destroy (subset);
+  hb_subset_input_destroy (input);
+  hb_face_destroy (face);
+}
+
+typedef struct {
+  hb_face_t *face;
+  unsigned int blob_requests;
+} tables_of_t;
+
+/* Hands out single tables only, like a table directory of the caller's;
+ * there is no blob of the whole font. */
+static hb_blob_t *
+reference_table_of (hb_face_t *face HB_UNUSED, hb_tag_t tag, void *user_data)
+{
+  tables_of_t *tables = (tables_of_t *) user_data;
+  if (tag == HB_TAG_NONE)
+  {
+    tables->blob_requests++;
+    return NULL;
+  }
+  return hb_face_reference_table (tables->face, tag);
+}
+
+static void
+test_subset_batch_for_tables (void)
+{
+  tables_of_t tables = {hb_subset_test_open_font ("fonts/Roboto-Regular.gsub.fil.ttf"), 0};
+  hb_face_t *face = hb_face_create_for_tables (reference_table_of, &tables, NULL);
+  const char *texts[] = {"fi", "l", "fil", "abc"};
+  hb_subset_input_t *inputs[G_N_ELEMENTS (texts)];
+  hb_face_t *subsets[G_N_ELEMENTS (texts)];
+  unsigned int total = 0;
+  unsigned int i;
+
+  for (i = 0; i < G_N_ELEMENTS (texts); i++)
+  {
+    const char *text;
+    inputs[i] = hb_subset_input_create_or_fail ();
+    for (text = texts[i]; *text; text++)
+      hb_set_add (hb_subset_input_unicode_set (inputs[i]), *text);
+  }
+
+  /* A face that does not hand out its data as one blob is not asked for
+   * one, and subsets the same in a batch as on its own. */
+  hb_subset_batch (face, inputs, G_N_ELEMENTS (texts), subsets, reverse_runner, &total);
+  g_assert_cmpuint (G_N_ELEMENTS (texts), ==, total);
+  g_assert_cmpuint (0, ==, tables.blob_requests);
+  for (i = 0; i < G_N_ELEMENTS (texts); i++)
+  {
+    hb_face_t *expected = hb_subset (face, inputs[i]);
+    hb_blob_t *expected_blob = hb_face_reference_blob (expected);
+    hb_blob_t *actual_blob = hb_face_reference_blob (subsets[i]);
+    g_assert (subsets[i] != hb_face_get_empty ());
+    hb_test_assert_blobs_equal (expected_blob, actual_blob);
+    hb_blob_destroy (expected_blob);
+    hb_blob_destroy (actual_blob);
+    hb_face_destroy (expected);
+    hb_face_destroy (subsets[i]);
+    hb_subset_input_destroy (inputs[i]);
+  }
+
+  hb_face_destroy (face);
+  hb_face_destroy (tables.face);
+}
+
+static unsigned int
+read_uint16 (const char *data, unsigned int offset)
+{
+  return ((unsigned int) (unsigned char) data[offset] << 8) + (unsigned char) data[offset + 1];
+}
+
+static void
+test_subset_shares_objects (void)
+{
+  hb_face_t *face = hb_subset_test_open_font ("fonts/Roboto-Regular.gsub.fi.ttf");
+  hb_blob_t *blob = subset_blob (face, "fi");
+  hb_face_t *subset = hb_face_create (blob, 0);
+  hb_blob_t *gsub = hb_face_reference_table (subset, HB_TAG ('G','S','U','B'));
+  const char *data = hb_blob_get_data (gsub, NULL);
+  unsigned int script_list, script, lang_sys_count, i;
+
+  /* The latn script has four language systems, all identical; they are
+   * written once and shared. */
+  g_assert_cmpuint (hb_blob_get_length (gsub), >, 0);
+  script_list = read_uint16 (data, 4);
+  g_assert_cmpuint (read_uint16 (data, script_list), ==, 4);
+  g_assert_cmpuint (read_uint16 (data, script_list + 2 + 3 * 6), ==, 'l' << 8 | 'a');
+  script = script_list + read_uint16 (data, script_list + 2 + 3 * 6 + 4);
+  lang_sys_count = read_uint16 (data, script + 2);
+  g_assert_cmpuint (lang_sys_count, ==, 4);
+  for (i = 1; i < lang_sys_count; i++)
+    g_assert_cmpuint (read_uint16 (data, script + 4 + 6 * i + 4), ==,
+		      read_uint16 (data, script + 4 + 4));
+
+  hb_blob_destroy (gsub);
+  hb_face_destroy (subset);
+  hb_blob_destroy (blob);
+  hb_face_destroy (face);
+}
+
+/* Subsets for all of the face's characters, keeping layout tables; the
+ * result is loaded from its blob, as a font read back from disk. */
+static hb_face_t *
+subset_all (hb_face_t *face)
+{
+  hb_subset_input_t *input = hb_subset_input_create_or_fail ();
+  hb_face_t *subset;
+  hb_blob_t *blob;
+
+  hb_subset_input_set_drop_layout (input, false);
+  hb_face_collect_unicodes (face, hb_subset_input_unicode_set (input));
+  subset = hb_subset (face, input);
+  blob = hb_face_reference_blob (subset);
+  hb_face_destroy (subset);
+  subset = hb_face_create (blob, 0);
+
+  hb_blob_destroy (blob);
+  hb_subset_input_destroy (input);
+  return subset;
+}
+
+static void
+assert_arrays_equal (const void   *expected,
+		     unsigned int  expected_count,
+		     const void   *actual,
+		     unsigned int  actual_count,
+		     unsigned int  item_size)
+{
+  g_assert_cmpuint (expected_count, ==, actual_count);
+  g_assert (0 == memcmp (expected, actual, expected_count * item_size));
+}
+
+static void
+assert_language_equal (hb_face_t    *expected,
+		       hb_face_t    *actual,
+		       hb_tag_t      table,
+		       unsigned int  script_index,
+		       unsigned int  language_index)
+{
+  unsigned int expected_features[64], actual_features[64];
+  unsigned int expected_count = G_N_ELEMENTS (expected_features);
+  unsigned int actual_count = G_N_ELEMENTS (actual_features);
+  unsigned int expected_required, actual_required;
+
+  hb_ot_layout_language_get_required_feature_index (expected, table, script_index, language_index, &expected_required);
+  hb_ot_layout_language_get_required_feature_index (actual, table, script_index, language_index, &actual_required);
+  g_assert_cmpuint (expected_required, ==, actual_required);
+
+  hb_ot_layout_language_get_feature_indexes (expected, table, script_index, language_index, 0, &expected_count, expected_features);
+  hb_ot_layout_language_get_feature_indexes (actual, table, script_index, language_index, 0, &actual_count, actual_features);
+  assert_arrays_equal (expected_features, expected_count, actual_features, actual_count, sizeof (unsigned int));
+}
+
+/* Compares what the layout table of each face reads as, once sanitized:
+ * scripts, language systems and features.  Lookups are left out, as the
+ * subsetter does not keep all of their subtables. */
+static void
+assert_layout_equal (hb_face_t *expected, hb_face_t *actual, hb_tag_t table)
+{
+  hb_tag_t expected_tags[64], actual_tags[64];
+  unsigned int expected_count = G_N_ELEMENTS (expected_tags);
+  unsigned int actual_count = G_N_ELEMENTS (actual_tags);
+  unsigned int script_count, i, j;
+
+  hb_ot_layout_table_get_feature_tags (expected, table, 0, &expected_count, expected_tags);
+  hb_ot_layout_table_get_feature_tags (actual, table, 0, &actual_count, actual_tags);
+  assert_arrays_equal (expected_tags, expected_count, actual_tags, actual_count, sizeof (hb_tag_t));
+  for (i = 0; i < expected_count; i++)
+  {
+    unsigned int expected_lookups[64], actual_lookups[64];
+    unsigned int expected_lookup_count = G_N_ELEMENTS (expected_lookups);
+    unsigned int actual_lookup_count = G_N_ELEMENTS (actual_lookups);
+
+    hb_ot_layout_feature_get_lookups (expected, table, i, 0, &expected_lookup_count, expected_lookups);
+    hb_ot_layout_feature_get_lookups (actual, table, i, 0, &actual_lookup_count, actual_lookups);
+    assert_arrays_equal (expected_lookups, expected_lookup_count, actual_lookups, actual_lookup_count, sizeof (unsigned int));
+  }
+
+  expected_count = actual_count = G_N_ELEMENTS (expected_tags);
+  hb_ot_layout_table_get_script_tags (expected, table, 0, &expected_count, expected_tags);
+  hb_ot_layout_table_get_script_tags (actual, table, 0, &actual_count, actual_tags);
+  assert_arrays_equal (expected_tags, expected_count, actual_tags, actual_count, sizeof (hb_tag_t));
+  script_count = expected_count;
+  for (i = 0; i < script_count; i++)
+  {
+    expected_count = actual_count = G_N_ELEMENTS (expected_tags);
+    hb_ot_layout_script_get_language_tags (expected, table, i, 0, &expected_count, expected_tags);
+    hb_ot_layout_script_get_language_tags (actual, table, i, 0, &actual_count, actual_tags);
+    assert_arrays_equal (expected_tags, expected_count, actual_tags, actual_count, sizeof (hb_tag_t));
+
+    assert_language_equal (expected, actual, table, i, HB_OT_LAYOUT_DEFAULT_LANGUAGE_INDEX);
+    for (j = 0; j < expected_count; j++)
+      assert_language_equal (expected, actual, table, i, j);
+  }
+}
+
+static void
+test_subset_layout_sanitizes (void)
+{
+  const char *fonts[] = {"fonts/07f054357ff8638bac3711b422a1e31180bba863.ttf",
+			 "fonts/Roboto-Regular.gsub.fi.ttf",
+			 "fonts/cv01.otf"};
+  unsigned int i;
+
+  /* Every object written, shared or not, must lie within the table;
+   * otherwise sanitizing the subset font drops it. */
+  for (i = 0; i < G_N_ELEMENTS (fonts); i++)
+  {
+    hb_face_t *face = hb_subset_test_open_font (fonts[i]);
+    hb_face_t *subset = subset_all (face);
+
+    assert_layout_equal (face, subset, HB_OT_TAG_GSUB);
+    assert_layout_equal (face, subset, HB_OT_TAG_GPOS);
+
+    hb_face_destroy (subset);
+    hb_face_destroy (face);
+  }
+}
+
+static hb_bool_t
+append_data (const char *data, unsigned int length, void *user_data)
+{
+  g_byte_array_append ((GByteArray *) user_data, (const guint8 *) data, length);
+  return TRUE;
+}
+
+static hb_bool_t
+fail_data (const char *data, unsigned int length, void *user_data)
+{
+  return FALSE;
+}
+
+static void
+test_subset_write (void)
+{
+  hb_face_t *face = hb_subset_test_open_font ("fonts/Roboto-Regular.abc.ttf");
+  hb_blob_t *expected = subset_blob (face, "ac");
+  hb_face_t *subset;
+  hb_subset_input_t *input = hb_subset_input_create_or_fail ();
+  GByteArray *written = g_byte_array_new ();
+  hb_blob_t *actual;
+
+  hb_subset_input_set_drop_layout (input, false);
+  hb_set_add (hb_subset_input_unicode_set (input), 'a');
+  hb_set_add (hb_subset_input_unicode_set (input), 'c');
+  subset = hb_subset (face, input);
+
+  /* Streamed output is the same as the assembled font, checksums
+   * included. */
+  g_assert (hb_face_builder_write (subset, append_data, written));
+  actual = hb_blob_create ((const char *) written->data, written->len,
+			   HB_MEMORY_MODE_READONLY, NULL, NULL);
+  hb_test_assert_blobs_equal (expected, actual);
+  hb_blob_destroy (actual);
+
+  g_assert (!hb_face_builder_write (subset, fail_data, NULL));
+  g_assert (!hb_face_builder_write (face, append_data, written));
+
+  g_byte_array_free (written, TRUE);
+  hb_face_destroy (subset);
+  hb_subset_input_destroy (input);
+  hb_blob_destroy (expected);
+  hb_face_destroy (face);
+}
+
+static unsigned int
+read_u32 (const guint8 *data)
+{
+  return (data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+}
+
+static void
+test_subset_write_woff (void)
+{
+  hb_face_t *face = hb_subset_test_open_font ("fonts/Roboto-Regular.abc.ttf");
+  hb_blob_t *expected = subset_blob (face, "ac");
+  hb_face_t *subset;
+  hb_subset_input_t *input = hb_subset_input_create_or_fail ();
+  GByteArray *written = g_byte_array_new ();
+
+  hb_subset_input_set_drop_layout (input, false);
+  hb_set_add (hb_subset_input_unicode_set (input), 'a');
+  hb_set_add (hb_subset_input_unicode_set (input), 'c');
+  subset = hb_subset (face, input);
+
+  g_assert (hb_subset_write (subset, HB_SUBSET_OUTPUT_FORMAT_WOFF, append_data, written));
+  g_assert_cmpuint (written->len, >=, 44);
+  g_assert_cmpuint (read_u32 (written->data), ==, HB_TAG ('w','O','F','F'));
+  g_assert_cmpuint (read_u32 (written->data + 8), ==, written->len);
+  g_assert_cmpuint ((written->data[12] << 8) | written->data[13], ==,
+		    hb_face_get_table_tags (subset, 0, NULL, NULL));
+  g_assert_cmpuint (read_u32 (written->data + 16), ==, hb_blob_get_length (expected));
+
+  /* WOFF2 is only available when built with brotli. */
+  g_byte_array_set_size (written, 0);
+  if (hb_subset_write (subset, HB_SUBSET_OUTPUT_FORMAT_WOFF2, append_data, written))
+  {
+    g_assert_cmpuint (written->len, >=, 48);
+    g_assert_cmpuint (read_u32 (written->data), ==, HB_TAG ('w','O','F','2'));
+    g_assert_cmpuint (read_u32 (written->data + 8), ==, written->len);
+    g_assert_cmpuint (read_u32 (written->data + 16), ==, hb_blob_get_length (expected));
+  }
+
+  g_assert (!hb_subset_write (subset, HB_SUBSET_OUTPUT_FORMAT_WOFF, fail_data, NULL));
+
+  g_byte_array_free (written, TRUE);
+  hb_face_destroy (subset);
+  hb_subset_input_destroy (input);
+  hb_blob_destroy (expected);
+  hb_face_destroy (face);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -103,6 +634,16 @@ main (int argc, char **argv)
   hb_test_add (test_subset_32_tables);
   hb_test_add (test_subset_no_inf_loop);
   hb_test_add (test_subset_crash);
+  hb_test_add (test_subset_parallel);
+  hb_test_add (test_subset_closure_cache);
+  hb_test_add (test_subset_closure_cache_drop);
+  hb_test_add (test_subset_batch);
+  hb_test_add (test_subset_batch_trusted);
+  hb_test_add (test_subset_batch_for_tables);
+  hb_test_add (test_subset_shares_objects);
+  hb_test_add (test_subset_layout_sanitizes);
+  hb_test_add (test_subset_write);
+  hb_test_add (test_subset_write_woff);
 
   return hb_test_run();
 }
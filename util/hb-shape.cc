@@ -37,7 +37,10 @@ struct output_buffer_t
 		    line_no (0),
 		    font (nullptr),
 		    output_format (HB_BUFFER_SERIALIZE_FORMAT_INVALID),
-		    format_flags (HB_BUFFER_SERIALIZE_FLAG_DEFAULT) {}
+		    format_flags (HB_BUFFER_SERIALIZE_FLAG_DEFAULT),
+		    trace_fp (nullptr),
+		    trace_start (0),
+		    trace_first_event (true) {}
 
   void init (hb_buffer_t *buffer, const font_options_t *font_opts)
   {
@@ -82,6 +85,17 @@ struct output_buffer_t
 
     if (format.trace)
       hb_buffer_set_message_func (buffer, message_func, this, nullptr);
+
+    if (format.trace_file)
+    {
+      trace_fp = fopen (format.trace_file, "w");
+      if (!trace_fp)
+	fail (false, "Cannot open trace file `%s': %s",
+	      format.trace_file, strerror (errno));
+      fprintf (trace_fp, "{\"traceEvents\": [");
+      trace_first_event = true;
+      hb_buffer_set_trace_func (buffer, trace_func, this, nullptr);
+    }
   }
   void new_line (void)
   {
@@ -115,6 +129,13 @@ struct output_buffer_t
   void finish (hb_buffer_t *buffer, const font_options_t *font_opts)
   {
     hb_buffer_set_message_func (buffer, nullptr, nullptr, nullptr);
+    if (trace_fp)
+    {
+      hb_buffer_set_trace_func (buffer, nullptr, nullptr, nullptr);
+      fprintf (trace_fp, "\n]}\n");
+      fclose (trace_fp);
+      trace_fp = nullptr;
+    }
     hb_font_destroy (font);
     g_string_free (gs, true);
     gs = nullptr;
@@ -145,6 +166,39 @@ struct output_buffer_t
     fprintf (options.fp, "%s", gs->str);
   }
 
+  static void
+  trace_func (hb_buffer_t *buffer,
+	      hb_font_t *font,
+	      hb_buffer_trace_event_t event,
+	      const char *stage,
+	      unsigned int stage_index,
+	      uint64_t timestamp,
+	      void *user_data)
+  {
+    output_buffer_t *that = (output_buffer_t *) user_data;
+    that->trace_event (event, stage, stage_index, timestamp);
+  }
+
+  void
+  trace_event (hb_buffer_trace_event_t event,
+	       const char *stage,
+	       unsigned int stage_index,
+	       uint64_t timestamp)
+  {
+    if (trace_first_event)
+      trace_start = timestamp;
+    /* Chrome trace timestamps are in microseconds. */
+    fprintf (trace_fp, "%s\n{\"name\": \"%s\", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": 1, \"tid\": 1, "
+		       "\"args\": {\"line\": %u, \"stage_index\": %u}}",
+	     trace_first_event ? "" : ",",
+	     stage,
+	     event == HB_BUFFER_TRACE_EVENT_BEGIN ? 'B' : 'E',
+	     (timestamp - trace_start) / 1000.,
+	     line_no,
+	     stage_index);
+    trace_first_event = false;
+  }
+
 
   protected:
   output_options_t options;
@@ -155,6 +209,10 @@ struct output_buffer_t
   hb_font_t *font;
   hb_buffer_serialize_format_t output_format;
   hb_buffer_serialize_flags_t format_flags;
+
+  FILE *trace_fp;
+  uint64_t trace_start;
+  bool trace_first_event;
 };
 
 int
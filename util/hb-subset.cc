@@ -34,10 +34,12 @@
  * Command line interface to the harfbuzz font subsetter.
  */
 
+static const char *subset_output_formats[] = {"ttf", "otf", "woff", "woff2", nullptr};
+
 struct subset_consumer_t
 {
   subset_consumer_t (option_parser_t *parser)
-      : failed (false), options (parser), subset_options (parser), font (nullptr), input (nullptr) {}
+      : failed (false), options (parser, subset_output_formats), subset_options (parser), font (nullptr), input (nullptr) {}
 
   void init (hb_buffer_t  *buffer_,
              const font_options_t *font_opts)
@@ -61,29 +63,52 @@ struct subset_consumer_t
     } while ((c = g_utf8_find_next_char(c, text + text_len)) != nullptr);
   }
 
+  static hb_bool_t
+  write_data (const char *data, unsigned int length, void *user_data)
+  {
+    FILE *fp_out = (FILE *) user_data;
+    return fwrite (data, 1, length, fp_out) == length;
+  }
+
+  hb_bool_t
+  get_output_format (hb_subset_output_format_t *format) {
+    const char *name = options.output_format;
+    *format = HB_SUBSET_OUTPUT_FORMAT_SFNT;
+    if (name && 0 == g_ascii_strcasecmp (name, "woff"))
+      *format = HB_SUBSET_OUTPUT_FORMAT_WOFF;
+    else if (name && 0 == g_ascii_strcasecmp (name, "woff2"))
+      *format = HB_SUBSET_OUTPUT_FORMAT_WOFF2;
+    else if (options.explicit_output_format &&
+	     0 != g_ascii_strcasecmp (name, "ttf") &&
+	     0 != g_ascii_strcasecmp (name, "otf")) {
+      gchar *items = g_strjoinv ("/", const_cast<char **> (subset_output_formats));
+      fprintf(stderr, "Unknown output format `%s'; supported formats are: %s\n", name, items);
+      g_free (items);
+      return false;
+    }
+    return true;
+  }
+
   hb_bool_t
-  write_file (const char *output_file, hb_blob_t *blob) {
-    unsigned int data_length;
-    const char* data = hb_blob_get_data (blob, &data_length);
+  write_file (const char *output_file, hb_face_t *face) {
+    hb_subset_output_format_t format;
+    if (!get_output_format (&format))
+      return false;
 
     FILE *fp_out = fopen(output_file, "wb");
     if (fp_out == nullptr) {
       fprintf(stderr, "Unable to open output file\n");
       return false;
     }
-    int bytes_written = fwrite(data, 1, data_length, fp_out);
+    /* Stream the tables out instead of assembling the font in memory. */
+    hb_bool_t ret = hb_subset_write (face, format, write_data, fp_out);
 
-    fclose (fp_out);
-
-    if (bytes_written == -1) {
+    if (fclose (fp_out) != 0)
+      ret = false;
+    if (!ret) {
       fprintf(stderr, "Unable to write output file\n");
       return false;
     }
-    if ((unsigned int) bytes_written != data_length) {
-      fprintf(stderr, "Expected %u bytes written, got %d\n", data_length,
-              bytes_written);
-      return false;
-    }
     return true;
   }
 
@@ -94,14 +119,11 @@ struct subset_consumer_t
     hb_face_t *face = hb_font_get_face (font);
 
     hb_face_t *new_face = hb_subset(face, input);
-    hb_blob_t *result = hb_face_reference_blob (new_face);
 
-    failed = !hb_blob_get_length (result);
-    if (!failed)
-      write_file (options.output_file, result);
+    failed = new_face == hb_face_get_empty () ||
+	     !write_file (options.output_file, new_face);
 
     hb_subset_input_destroy (input);
-    hb_blob_destroy (result);
     hb_face_destroy (new_face);
     hb_font_destroy (font);
   }
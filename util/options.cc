@@ -854,6 +854,7 @@ format_options_t::add_options (option_parser_t *parser)
     {"ned",	      'v', G_OPTION_FLAG_NO_ARG,
 			      G_OPTION_ARG_CALLBACK,	(gpointer) &parse_ned,		"No Extra Data; Do not output clusters or advances",			nullptr},
     {"trace",	      'V', 0, G_OPTION_ARG_NONE,	&this->trace,			"Output interim shaping results",					nullptr},
+    {"trace-file",	0, 0, G_OPTION_ARG_STRING,	&this->trace_file,		"Write shaping stage timings to file, in Chrome trace JSON format",	"filename"},
     {nullptr}
   };
   parser->add_group (entries,
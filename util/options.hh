@@ -617,6 +617,7 @@ struct format_options_t : option_group_t
     show_extents = false;
     show_flags = false;
     trace = false;
+    trace_file = nullptr;
 
     add_options (parser);
   }
@@ -662,6 +663,7 @@ struct format_options_t : option_group_t
   hb_bool_t show_extents;
   hb_bool_t show_flags;
   hb_bool_t trace;
+  const char *trace_file;
 };
 
 struct subset_options_t : option_group_t